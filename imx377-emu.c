@@ -0,0 +1,330 @@
+    /* SPDX-License-Identifier: GPL-2.0 */
+    /*
+     * Emulated Sony IMX377 as an I2C target (i2c-slave backend), so the
+     * imx377 driver can be probed and benchmarked with no camera attached.
+     *
+     *  - 64 KiB register file with 16‑bit addressing and auto‑increment.
+     *  - STANDBY / MODE_SELECT behave like the sensor: streaming starts only
+     *    out of standby, and standby pauses it.
+     *  - Configurable per‑transaction latency of up to 50 us (clock
+     *    stretching, on controllers that support it) and periodic NACKs.
+     *  - Every register write is logged with a timestamp.
+     *
+     * Instantiate it on an adapter with target support, at the address the
+     * driver is bound to, e.g.
+     *
+     *   echo slave-imx377 0x101a > /sys/bus/i2c/devices/i2c-1/new_device
+     *
+     * and control it through debugfs imx377-emu-<device>/.
+     */
+
+    #include <linux/module.h>
+    #include <linux/i2c.h>
+    #include <linux/debugfs.h>
+    #include <linux/delay.h>
+    #include <linux/ktime.h>
+    #include <linux/seq_file.h>
+    #include <linux/slab.h>
+    #include <linux/spinlock.h>
+
+    /* Registers with behaviour beyond plain storage (see imx377.c) */
+    #define IMX377_EMU_STANDBY      0x3000
+    #define IMX377_EMU_XMSTA        0x3002
+    #define IMX377_EMU_MODE_SELECT  0x0100
+
+    #define IMX377_EMU_NUM_REGS     0x10000
+    #define IMX377_EMU_LOG_LEN      4096    /* register writes kept, oldest dropped */
+    /*
+     * The stall is a busy wait in the target controller's interrupt handler,
+     * so it is kept to a few bus bytes' worth; larger latency_us values are
+     * clamped to it.
+     */
+    #define IMX377_EMU_MAX_LATENCY  50      /* us */
+
+    struct imx377_emu_write {
+        u64 ns;
+        u16 addr;
+        u8  val;
+    };
+
+    struct imx377_emu {
+        struct i2c_client       *client;
+        spinlock_t              lock;   /* everything below, taken in IRQ context */
+        u8                      *regs;
+        u16                     addr;   /* auto‑increment pointer */
+        unsigned int            idx;    /* bytes received in this write */
+        bool                    streaming;
+
+        /* Knobs, set through debugfs */
+        u32                     latency_us;
+        u32                     nack_every;     /* NACK every Nth transaction, 0 = never */
+
+        u32                     xfers;
+        u32                     writes;
+        u32                     nacks;
+        u32                     mode_errors;    /* MODE_SELECT=1 while in standby */
+
+        struct imx377_emu_write *log;
+        unsigned int            log_head;
+        unsigned int            log_len;
+
+        struct dentry           *debugfs;
+    };
+
+    /* ------------------------------------------------------------------ */
+    /* Register file                                                       */
+    /* ------------------------------------------------------------------ */
+
+    static void imx377_emu_reset(struct imx377_emu *emu)
+    {
+        memset(emu->regs, 0, IMX377_EMU_NUM_REGS);
+        emu->regs[IMX377_EMU_STANDBY] = 0x01;
+        emu->regs[IMX377_EMU_XMSTA] = 0x01;
+        emu->streaming = false;
+    }
+
+    static void imx377_emu_log(struct imx377_emu *emu, u16 addr, u8 val)
+    {
+        struct imx377_emu_write *w;
+
+        w = &emu->log[(emu->log_head + emu->log_len) % IMX377_EMU_LOG_LEN];
+        if (emu->log_len < IMX377_EMU_LOG_LEN)
+            emu->log_len++;
+        else
+            emu->log_head = (emu->log_head + 1) % IMX377_EMU_LOG_LEN;
+
+        w->ns = ktime_get_ns();
+        w->addr = addr;
+        w->val = val;
+    }
+
+    static void imx377_emu_write(struct imx377_emu *emu, u16 addr, u8 val)
+    {
+        emu->writes++;
+        imx377_emu_log(emu, addr, val);
+
+        switch (addr) {
+        case IMX377_EMU_STANDBY:
+            /* Standby stops readout; leaving it resumes a latched MODE_SELECT */
+            emu->streaming = !(val & 0x01) &&
+                             (emu->regs[IMX377_EMU_MODE_SELECT] & 0x01);
+            break;
+        case IMX377_EMU_MODE_SELECT:
+            if ((val & 0x01) && (emu->regs[IMX377_EMU_STANDBY] & 0x01)) {
+                emu->mode_errors++;
+                val = 0x00;
+            }
+            emu->streaming = val & 0x01;
+            break;
+        }
+        emu->regs[addr] = val;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Target callback                                                     */
+    /* ------------------------------------------------------------------ */
+
+    /*
+     * Start of a transaction: count it, maybe refuse it (*@ret = -EIO), and
+     * return how long to stall it. The caller stalls after dropping the lock.
+     */
+    static u32 imx377_emu_begin(struct imx377_emu *emu, int *ret)
+    {
+        emu->xfers++;
+        if (emu->nack_every && !(emu->xfers % emu->nack_every)) {
+            emu->nacks++;
+            *ret = -EIO;
+        }
+        return min_t(u32, emu->latency_us, IMX377_EMU_MAX_LATENCY);
+    }
+
+    /*
+     * Writes carry the 16‑bit start address then data; reads continue from
+     * the address last set, both auto‑incrementing.
+     */
+    static int imx377_emu_slave_cb(struct i2c_client *client,
+                                   enum i2c_slave_event event, u8 *val)
+    {
+        struct imx377_emu *emu = i2c_get_clientdata(client);
+        u32 stall_us = 0;
+        int ret = 0;
+
+        spin_lock(&emu->lock);
+        switch (event) {
+        case I2C_SLAVE_WRITE_REQUESTED:
+            emu->idx = 0;
+            stall_us = imx377_emu_begin(emu, &ret);
+            break;
+        case I2C_SLAVE_WRITE_RECEIVED:
+            if (emu->idx < 2)
+                emu->addr = emu->idx ? (emu->addr & 0xFF00) | *val : *val << 8;
+            else
+                imx377_emu_write(emu, emu->addr++, *val);
+            emu->idx++;
+            break;
+        case I2C_SLAVE_READ_PROCESSED:
+            /* The previous byte was taken, move on */
+            emu->addr++;
+            fallthrough;
+        case I2C_SLAVE_READ_REQUESTED:
+            if (event == I2C_SLAVE_READ_REQUESTED)
+                stall_us = imx377_emu_begin(emu, &ret);
+            /* MODE_SELECT reads back what the sensor is doing */
+            if (emu->addr == IMX377_EMU_MODE_SELECT)
+                *val = emu->streaming;
+            else
+                *val = emu->regs[emu->addr];
+            break;
+        case I2C_SLAVE_STOP:
+            emu->idx = 0;
+            break;
+        default:
+            break;
+        }
+        spin_unlock(&emu->lock);
+
+        /* Clock stretching (bounded, see above), without holding off debugfs */
+        if (stall_us)
+            udelay(stall_us);
+        return ret;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* debugfs                                                             */
+    /* ------------------------------------------------------------------ */
+
+    static int imx377_emu_log_show(struct seq_file *m, void *data)
+    {
+        struct imx377_emu *emu = m->private;
+        struct imx377_emu_write *copy;
+        unsigned int i, len;
+
+        copy = kvmalloc_array(IMX377_EMU_LOG_LEN, sizeof(*copy), GFP_KERNEL);
+        if (!copy)
+            return -ENOMEM;
+
+        spin_lock_irq(&emu->lock);
+        len = emu->log_len;
+        for (i = 0; i < len; i++)
+            copy[i] = emu->log[(emu->log_head + i) % IMX377_EMU_LOG_LEN];
+        spin_unlock_irq(&emu->lock);
+
+        for (i = 0; i < len; i++)
+            seq_printf(m, "%llu 0x%04x 0x%02x\n", copy[i].ns, copy[i].addr,
+                       copy[i].val);
+        kvfree(copy);
+        return 0;
+    }
+
+    static int imx377_emu_log_open(struct inode *inode, struct file *file)
+    {
+        return single_open(file, imx377_emu_log_show, inode->i_private);
+    }
+
+    /* Any write empties the log */
+    static ssize_t imx377_emu_log_write(struct file *file, const char __user *buf,
+                                        size_t count, loff_t *ppos)
+    {
+        struct imx377_emu *emu = ((struct seq_file *)file->private_data)->private;
+
+        spin_lock_irq(&emu->lock);
+        emu->log_head = 0;
+        emu->log_len = 0;
+        spin_unlock_irq(&emu->lock);
+        return count;
+    }
+
+    static const struct file_operations imx377_emu_log_fops = {
+        .owner   = THIS_MODULE,
+        .open    = imx377_emu_log_open,
+        .read    = seq_read,
+        .write   = imx377_emu_log_write,
+        .llseek  = seq_lseek,
+        .release = single_release,
+    };
+
+    static int imx377_emu_stats_show(struct seq_file *m, void *data)
+    {
+        struct imx377_emu *emu = m->private;
+
+        spin_lock_irq(&emu->lock);
+        seq_printf(m, "transactions %u writes %u nacks %u mode_errors %u streaming %d\n",
+                   emu->xfers, emu->writes, emu->nacks, emu->mode_errors,
+                   emu->streaming);
+        spin_unlock_irq(&emu->lock);
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(imx377_emu_stats);
+
+    static void imx377_emu_debugfs_init(struct imx377_emu *emu)
+    {
+        char name[32];
+
+        snprintf(name, sizeof(name), "imx377-emu-%s", dev_name(&emu->client->dev));
+        emu->debugfs = debugfs_create_dir(name, NULL);
+
+        debugfs_create_u32("latency_us", 0644, emu->debugfs, &emu->latency_us);
+        debugfs_create_u32("nack_every", 0644, emu->debugfs, &emu->nack_every);
+        debugfs_create_file("log", 0644, emu->debugfs, emu, &imx377_emu_log_fops);
+        debugfs_create_file("stats", 0444, emu->debugfs, emu,
+                            &imx377_emu_stats_fops);
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Probe / Remove                                                      */
+    /* ------------------------------------------------------------------ */
+
+    static int imx377_emu_probe(struct i2c_client *client)
+    {
+        struct device *dev = &client->dev;
+        struct imx377_emu *emu;
+        int ret;
+
+        emu = devm_kzalloc(dev, sizeof(*emu), GFP_KERNEL);
+        if (!emu)
+            return -ENOMEM;
+
+        emu->client = client;
+        spin_lock_init(&emu->lock);
+        emu->regs = devm_kzalloc(dev, IMX377_EMU_NUM_REGS, GFP_KERNEL);
+        emu->log = devm_kcalloc(dev, IMX377_EMU_LOG_LEN, sizeof(*emu->log),
+                                GFP_KERNEL);
+        if (!emu->regs || !emu->log)
+            return -ENOMEM;
+        imx377_emu_reset(emu);
+        i2c_set_clientdata(client, emu);
+
+        ret = i2c_slave_register(client, imx377_emu_slave_cb);
+        if (ret)
+            return ret;
+
+        imx377_emu_debugfs_init(emu);
+        return 0;
+    }
+
+    static void imx377_emu_remove(struct i2c_client *client)
+    {
+        struct imx377_emu *emu = i2c_get_clientdata(client);
+
+        debugfs_remove_recursive(emu->debugfs);
+        i2c_slave_unregister(client);
+    }
+
+    static const struct i2c_device_id imx377_emu_id[] = {
+        { "slave-imx377" },
+        { }
+    };
+    MODULE_DEVICE_TABLE(i2c, imx377_emu_id);
+
+    static struct i2c_driver imx377_emu_driver = {
+        .driver = {
+            .name = "imx377-emu",
+        },
+        .probe    = imx377_emu_probe,
+        .remove   = imx377_emu_remove,
+        .id_table = imx377_emu_id,
+    };
+    module_i2c_driver(imx377_emu_driver);
+
+    MODULE_DESCRIPTION("Emulated Sony IMX377 I2C target");
+    MODULE_LICENSE("GPL v2");
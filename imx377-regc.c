@@ -0,0 +1,449 @@
+    /* SPDX-License-Identifier: GPL-2.0 */
+    /*
+     * imx377-regc: compile the IMX377 register tables (imx377_tables.regs)
+     * into the burst tables the driver sends (imx377_tables.h).
+     *
+     * Each table is validated (known, non‑reserved registers, 8‑bit values,
+     * no register set twice between barriers), sorted by address within each
+     * barrier section and merged into auto‑increment bursts of at most
+     * MAX_BURST values. Delta tables between every pair of modes hold only
+     * the entries the source mode does not already leave in place. A report
+     * of registers, transactions and bus bytes per table goes to stdout.
+     *
+     *   imx377-regc imx377_tables.regs imx377_tables.h > imx377_tables.report
+     *
+     * Host program, built and run by Kbuild.
+     */
+
+    #include <errno.h>
+    #include <stdarg.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    #define MAX_BURST   64      /* must not exceed IMX377_MAX_BURST */
+    #define MAX_NAMES   256
+    #define MAX_TABLES  64
+    #define MAX_ENTRIES 1024
+    #define MAX_TOKENS  32      /* per line; longer lines are rejected */
+
+    struct reg_name {
+        char name[32];
+        unsigned int addr;
+        int reserved;
+    };
+
+    struct entry {
+        unsigned int addr;
+        unsigned int val;
+        unsigned int section;   /* barriers passed before this entry */
+        unsigned int line;
+    };
+
+    struct table {
+        char name[32];
+        int is_mode;
+        struct entry entries[MAX_ENTRIES];
+        unsigned int nr;
+        unsigned int section;
+    };
+
+    /* A compiled table: packed bursts of address (BE16), length, values */
+    struct burst_table {
+        unsigned char data[MAX_ENTRIES * 4];
+        unsigned int size;
+        unsigned int bursts;
+        unsigned int regs;
+    };
+
+    static struct reg_name names[MAX_NAMES];
+    static unsigned int nr_names;
+    static struct table tables[MAX_TABLES];
+    static unsigned int nr_tables;
+
+    static const char *src_path;
+    static unsigned int src_line;
+
+    static void die(const char *fmt, ...)
+    {
+        va_list ap;
+
+        fprintf(stderr, "%s:%u: ", src_path, src_line);
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+        fputc('\n', stderr);
+        exit(1);
+    }
+
+    static unsigned long parse_num(const char *s, unsigned long max, const char *what)
+    {
+        unsigned long v;
+        char *end;
+
+        errno = 0;
+        v = strtoul(s, &end, 0);
+        if (errno || *end || end == s || v > max)
+            die("bad %s '%s'", what, s);
+        return v;
+    }
+
+    static struct reg_name *find_name(const char *name)
+    {
+        unsigned int i;
+
+        for (i = 0; i < nr_names; i++)
+            if (!strcmp(names[i].name, name))
+                return &names[i];
+        return NULL;
+    }
+
+    static void check_ident(const char *name)
+    {
+        const char *p;
+
+        if (strlen(name) >= sizeof(names[0].name))
+            die("name '%s' too long", name);
+        for (p = name; *p; p++)
+            if (!(*p == '_' || (*p >= '0' && *p <= '9') ||
+                  (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')))
+                die("'%s' is not a valid name", name);
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Parser                                                              */
+    /* ------------------------------------------------------------------ */
+
+    static void add_entry(struct table *t, const char *reg, const char *val)
+    {
+        struct reg_name *n = find_name(reg);
+        struct entry *e;
+        unsigned int addr, i;
+
+        addr = n ? n->addr : parse_num(reg, 0xFFFF, "register");
+        for (i = 0; i < nr_names; i++)
+            if (names[i].addr == addr && names[i].reserved)
+                die("%s is reserved for the driver", names[i].name);
+        for (i = 0; i < t->nr; i++)
+            if (t->entries[i].addr == addr && t->entries[i].section == t->section)
+                die("0x%04x already set at line %u, add a barrier to set it again",
+                    addr, t->entries[i].line);
+        if (t->nr == MAX_ENTRIES)
+            die("table %s too large", t->name);
+
+        e = &t->entries[t->nr++];
+        e->addr = addr;
+        e->val = parse_num(val, 0xFF, "value");
+        e->section = t->section;
+        e->line = src_line;
+    }
+
+    static void parse(FILE *f)
+    {
+        struct table *cur = NULL;
+        char line[256];
+
+        while (fgets(line, sizeof(line), f)) {
+            char *tok[MAX_TOKENS], *hash, *p;
+            unsigned int n = 0, i;
+
+            src_line++;
+            if (!strchr(line, '\n') && !feof(f))
+                die("line longer than %zu characters", sizeof(line) - 2);
+            hash = strchr(line, '#');
+            if (hash)
+                *hash = '\0';
+            /* Never drop a field silently: a lost name would go unreserved */
+            for (p = strtok(line, " \t\r\n"); p; p = strtok(NULL, " \t\r\n")) {
+                if (n == MAX_TOKENS)
+                    die("more than %d fields on one line", MAX_TOKENS);
+                tok[n++] = p;
+            }
+            if (!n)
+                continue;
+
+            if (!strcmp(tok[0], "reg")) {
+                if (n != 3)
+                    die("usage: reg NAME ADDR");
+                check_ident(tok[1]);
+                if (find_name(tok[1]))
+                    die("register %s defined twice", tok[1]);
+                if (nr_names == MAX_NAMES)
+                    die("too many registers");
+                strcpy(names[nr_names].name, tok[1]);
+                names[nr_names].addr = parse_num(tok[2], 0xFFFF, "address");
+                nr_names++;
+            } else if (!strcmp(tok[0], "reserved")) {
+                for (i = 1; i < n; i++) {
+                    struct reg_name *r = find_name(tok[i]);
+
+                    if (!r)
+                        die("unknown register %s", tok[i]);
+                    r->reserved = 1;
+                }
+            } else if (!strcmp(tok[0], "mode") || !strcmp(tok[0], "format")) {
+                if (n != 2)
+                    die("usage: %s NAME", tok[0]);
+                check_ident(tok[1]);
+                for (i = 0; i < nr_tables; i++)
+                    if (!strcmp(tables[i].name, tok[1]))
+                        die("table %s defined twice", tok[1]);
+                if (nr_tables == MAX_TABLES)
+                    die("too many tables");
+                cur = &tables[nr_tables++];
+                strcpy(cur->name, tok[1]);
+                cur->is_mode = tok[0][0] == 'm';
+            } else if (!strcmp(tok[0], "barrier")) {
+                if (!cur || n != 1)
+                    die("barrier outside a table");
+                cur->section++;
+            } else {
+                if (!cur)
+                    die("register entry outside a table");
+                if (n != 2)
+                    die("usage: NAME VALUE");
+                add_entry(cur, tok[0], tok[1]);
+            }
+        }
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Burst compiler                                                      */
+    /* ------------------------------------------------------------------ */
+
+    static int cmp_entry(const void *a, const void *b)
+    {
+        const struct entry *x = a, *y = b;
+
+        if (x->section != y->section)
+            return x->section < y->section ? -1 : 1;
+        if (x->addr != y->addr)
+            return x->addr < y->addr ? -1 : 1;
+        return 0;
+    }
+
+    /*
+     * Sort each barrier section by address (sections keep their order) and
+     * pack address‑contiguous runs into bursts.
+     */
+    static void compile(const struct entry *in, unsigned int nr,
+                        struct burst_table *out)
+    {
+        struct entry sorted[MAX_ENTRIES];
+        unsigned int i, head = 0, len = 0;
+
+        memcpy(sorted, in, nr * sizeof(*in));
+        qsort(sorted, nr, sizeof(*sorted), cmp_entry);
+
+        memset(out, 0, sizeof(*out));
+        for (i = 0; i < nr; i++) {
+            const struct entry *e = &sorted[i];
+
+            if (len && (e->section != sorted[i - 1].section ||
+                        e->addr != sorted[i - 1].addr + 1 || len == MAX_BURST)) {
+                out->data[head + 2] = len;
+                len = 0;
+            }
+            if (!len) {
+                head = out->size;
+                out->data[out->size++] = e->addr >> 8;
+                out->data[out->size++] = e->addr & 0xFF;
+                out->size++;
+                out->bursts++;
+            }
+            out->data[out->size++] = e->val;
+            len++;
+        }
+        if (len)
+            out->data[head + 2] = len;
+        out->regs = nr;
+    }
+
+    /*
+     * Entries of @to still needed after @from: walk @to in send order against
+     * what @from left in the sensor, keeping those that change something.
+     * Registers @from does not set are always kept.
+     */
+    static unsigned int delta(const struct table *from, const struct table *to,
+                              struct entry *out)
+    {
+        static int known[0x10000];
+        static unsigned char state[0x10000];
+        struct entry sorted[MAX_ENTRIES];
+        unsigned int i, nr = 0;
+
+        memset(known, 0, sizeof(known));
+        memcpy(sorted, from->entries, from->nr * sizeof(*sorted));
+        qsort(sorted, from->nr, sizeof(*sorted), cmp_entry);
+        for (i = 0; i < from->nr; i++) {
+            known[sorted[i].addr] = 1;
+            state[sorted[i].addr] = sorted[i].val;
+        }
+
+        memcpy(sorted, to->entries, to->nr * sizeof(*sorted));
+        qsort(sorted, to->nr, sizeof(*sorted), cmp_entry);
+        for (i = 0; i < to->nr; i++) {
+            const struct entry *e = &sorted[i];
+
+            if (known[e->addr] && state[e->addr] == e->val)
+                continue;
+            known[e->addr] = 1;
+            state[e->addr] = e->val;
+            out[nr++] = *e;
+        }
+        return nr;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Output                                                              */
+    /* ------------------------------------------------------------------ */
+
+    /* Bus bytes: each burst carries a 2‑byte address instead of a length byte */
+    static unsigned int bus_bytes(const struct burst_table *b)
+    {
+        return b->size - b->bursts;
+    }
+
+    static void report(const char *kind, const char *name, const struct burst_table *b)
+    {
+        char label[80];
+
+        snprintf(label, sizeof(label), "%s %.64s", kind, name);
+        printf("%-32s %5u %7u %6u %10u %9u\n", label, b->regs, b->bursts,
+               bus_bytes(b), b->regs, b->regs * 3);
+    }
+
+    static void emit_data(FILE *f, const char *sym, const struct burst_table *b)
+    {
+        unsigned int i = 0;
+
+        if (!b->size)
+            return;
+        fprintf(f, "    static const u8 %s_data[] = {\n", sym);
+        while (i < b->size) {
+            unsigned int len = b->data[i + 2], j;
+
+            fprintf(f, "        0x%02x, 0x%02x, %u,", b->data[i], b->data[i + 1], len);
+            for (j = 0; j < len; j++)
+                fprintf(f, " 0x%02x,", b->data[i + 3 + j]);
+            fputc('\n', f);
+            i += 3 + len;
+        }
+        fprintf(f, "    };\n\n");
+    }
+
+    static void emit_table(FILE *f, const char *indent, const char *sym,
+                           const struct burst_table *b)
+    {
+        fprintf(f, "%s.regs = %u, .bursts = %u, .size = %u,\n",
+                indent, b->regs, b->bursts, b->size);
+        if (b->size)
+            fprintf(f, "%s.data = %s_data,\n", indent, sym);
+    }
+
+    static const char *table_sym(const struct table *t)
+    {
+        static char sym[80];
+
+        snprintf(sym, sizeof(sym), "imx377_%s_%.31s",
+                 t->is_mode ? "mode" : "format", t->name);
+        return sym;
+    }
+
+    int main(int argc, char **argv)
+    {
+        static struct burst_table b;
+        static struct entry d[MAX_ENTRIES];
+        unsigned int i, j, nr_modes = 0;
+        char sym[160];
+        FILE *in, *out;
+
+        if (argc != 3) {
+            fprintf(stderr, "usage: %s TABLES.regs OUTPUT.h\n", argv[0]);
+            return 2;
+        }
+
+        src_path = argv[1];
+        in = fopen(src_path, "r");
+        if (!in) {
+            perror(src_path);
+            return 1;
+        }
+        parse(in);
+        fclose(in);
+        src_line = 0;
+
+        out = fopen(argv[2], "w");
+        if (!out) {
+            perror(argv[2]);
+            return 1;
+        }
+
+        fprintf(out, "    /* SPDX-License-Identifier: GPL-2.0 */\n");
+        fprintf(out, "    /* Generated by imx377-regc from %s, do not edit */\n\n",
+                strrchr(src_path, '/') ? strrchr(src_path, '/') + 1 : src_path);
+        fprintf(out, "    #define IMX377_TABLES_MAX_BURST %u\n\n", MAX_BURST);
+
+        printf("%-32s %5s %7s %6s %10s %9s\n", "table", "regs", "xfers", "bytes",
+               "1by1xfers", "1by1bytes");
+
+        for (i = 0; i < nr_tables; i++) {
+            const struct table *t = &tables[i];
+
+            nr_modes += t->is_mode;
+            compile(t->entries, t->nr, &b);
+            report(t->is_mode ? "mode" : "format", t->name, &b);
+            snprintf(sym, sizeof(sym), "%s", table_sym(t));
+            emit_data(out, sym, &b);
+            fprintf(out, "    static const struct imx377_table %s = {\n", sym);
+            emit_table(out, "        ", sym, &b);
+            fprintf(out, "    };\n\n");
+        }
+
+        for (i = 0; i < nr_tables; i++) {
+            for (j = 0; j < nr_tables; j++) {
+                char label[80];
+
+                if (i == j || !tables[i].is_mode || !tables[j].is_mode)
+                    continue;
+                compile(d, delta(&tables[i], &tables[j], d), &b);
+                snprintf(label, sizeof(label), "%.31s->%.31s", tables[i].name,
+                         tables[j].name);
+                report("delta", label, &b);
+                snprintf(sym, sizeof(sym), "imx377_delta_%s_%s", tables[i].name,
+                         tables[j].name);
+                emit_data(out, sym, &b);
+            }
+        }
+
+        fprintf(out, "    static const struct imx377_delta imx377_mode_deltas[] = {\n");
+        for (i = 0; i < nr_tables; i++) {
+            for (j = 0; j < nr_tables; j++) {
+                if (i == j || !tables[i].is_mode || !tables[j].is_mode)
+                    continue;
+                compile(d, delta(&tables[i], &tables[j], d), &b);
+                snprintf(sym, sizeof(sym), "imx377_delta_%s_%s", tables[i].name,
+                         tables[j].name);
+                fprintf(out, "        {\n");
+                fprintf(out, "            .from = &%s,\n", table_sym(&tables[i]));
+                fprintf(out, "            .to   = &%s,\n", table_sym(&tables[j]));
+                fprintf(out, "            .table = {\n");
+                emit_table(out, "                ", sym, &b);
+                fprintf(out, "            },\n");
+                fprintf(out, "        },\n");
+            }
+        }
+        fprintf(out, "    };\n");
+
+        if (nr_modes < 1) {
+            fprintf(stderr, "%s: no modes\n", src_path);
+            fclose(out);
+            remove(argv[2]);
+            return 1;
+        }
+        if (fclose(out)) {
+            perror(argv[2]);
+            return 1;
+        }
+        return 0;
+    }
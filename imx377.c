@@ -7,7 +7,8 @@
      *  - This is a reference starter implementation intended for public release.
      *  - Register tables for additional modes, and fine‑grained control handling
      *    (HDR, test‑pattern, per‑channel gains) are TODO.
-     *  - Compile‑tested against Linux 6.6 but not yet runtime‑verified on hardware.
+     *  - Written against Linux 6.13+ (subdev state helpers, single‑argument
+     *    .probe, hrtimer_setup); not yet runtime‑verified on hardware.
      *
      *  Contributors are welcome — please send pull requests!
      */
@@ -15,18 +16,42 @@
     #include <linux/module.h>
     #include <linux/i2c.h>
     #include <linux/clk.h>
+    #include <linux/crc32.h>
     #include <linux/delay.h>
+    #include <linux/firmware.h>
     #include <linux/gpio/consumer.h>
     #include <linux/regulator/consumer.h>
+    #include <linux/debugfs.h>
+    #include <linux/gcd.h>
+    #include <linux/hrtimer.h>
+    #include <linux/interrupt.h>
+    #include <linux/list.h>
+    #include <linux/ktime.h>
+    #include <linux/log2.h>
+    #include <linux/math64.h>
     #include <linux/mutex.h>
+    #include <linux/percpu.h>
+    #include <linux/pm_runtime.h>
+    #include <linux/property.h>
+    #include <linux/regmap.h>
+    #include <linux/seq_file.h>
+    #include <linux/slab.h>
+    #include <linux/workqueue.h>
     #include <linux/of_graph.h>
+    #include <linux/imx377.h>
     #include <media/v4l2-ctrls.h>
     #include <media/v4l2-fwnode.h>
     #include <media/v4l2-subdev.h>
     #include <media/v4l2-device.h>
+    #include <media/v4l2-event.h>
+
+    #define CREATE_TRACE_POINTS
+    #include "imx377_trace.h"
 
     /* ---- Key sensor registers (datasheet §Register Map) ---- */
     #define IMX377_STANDBY          0x3000
+    #define IMX377_REG_HOLD         0x3001  /* 1 = hold, 0 = latch held regs at next frame */
+    #define IMX377_REG_XMSTA        0x3002  /* 0 = master operation runs, 1 = held */
     #define IMX377_REG_MODE_SELECT  0x0100  /* 0x00 = standby, 0x01 = streaming */
     #define IMX377_REG_GAIN_H       0x3009  /* 11‑bit gain (H:L) */
     #define IMX377_REG_GAIN_L       0x300A
@@ -37,242 +62,3226 @@
     #define IMX377_REG_HMAX_H       0x30F5
     #define IMX377_REG_HMAX_L       0x30F6
 
-    #define IMX377_LINK_FREQ_576MHZ 576000000ULL
+    #define IMX377_REG_MDSEL1       0x3004  /* readout mode select 1..4 */
+    #define IMX377_REG_MDSEL2       0x3005
+    #define IMX377_REG_MDSEL3       0x3006
+    #define IMX377_REG_MDSEL4       0x3007
+    #define IMX377_REG_ADBIT        0x3008  /* ADC resolution: 0 = 10‑bit, 1 = 12‑bit */
+    #define IMX377_REG_ODBIT        0x3044  /* output width: 0 = RAW10, 1 = RAW12 */
+    #define IMX377_REG_SYNCSEL      0x304B  /* XVS/XHS pins: 0x0A = drive, 0x00 = input */
+    #define IMX377_REG_WINPH_H      0x3120  /* readout window, in array pixels: */
+    #define IMX377_REG_WINPH_L      0x3121  /*   PH/PV = start, WH/WV = size    */
+    #define IMX377_REG_WINWH_H      0x3122
+    #define IMX377_REG_WINWH_L      0x3123
+    #define IMX377_REG_WINPV_H      0x3124
+    #define IMX377_REG_WINPV_L      0x3125
+    #define IMX377_REG_WINWV_H      0x3126
+    #define IMX377_REG_WINWV_L      0x3127
+    #define IMX377_REG_LAST         0x31FF  /* end of the sensor control block */
+
+    #define IMX377_NATIVE_WIDTH     4056
+    #define IMX377_NATIVE_HEIGHT    3040
+    #define IMX377_MIN_CROP_WIDTH   256
+    #define IMX377_MIN_CROP_HEIGHT  128
+
+    #define IMX377_VTS_MAX          0xFFFF
+    #define IMX377_EXPOSURE_MIN     1
+    #define IMX377_EXPOSURE_MARGIN  8       /* lines between exposure and VMAX */
+    #define IMX377_EXPOSURE_DEFAULT 0x03E8
+
+    /* Frames from a register write until the value shows in the output */
+    #define IMX377_EXPOSURE_DELAY   2       /* also VMAX */
+    #define IMX377_GAIN_DELAY       1
+    #define IMX377_CTRL_QUEUE_LEN   8
+
+    #define IMX377_LINK_FREQ_576MHZ 576000000ULL
+    #define IMX377_NUM_LANES        4
+    #define IMX377_INCK_FREQ        24000000
+
+    /*
+     * Line time is HMAX counts of IMX377_HMAX_UNIT cycles of the readout
+     * clock, 16 x INCK, whatever the output width: the mode tables are
+     * timed for it, and it is also what a 4‑lane 576 MHz link carries at
+     * 12 bpp. RAW10 reads out at the same rate, with link time to spare.
+     */
+    #define IMX377_PIXEL_RATE       (16ULL * IMX377_INCK_FREQ)
+    #define IMX377_HMAX_UNIT        12      /* pixel clocks per HMAX count */
+
+    static const s64 imx377_link_freqs[] = {
+        IMX377_LINK_FREQ_576MHZ,
+    };
+
+    /*
+     * Power‑up timing defaults, each overridable from DT. Not yet checked
+     * against the datasheet, so they stay as long as the fixed 5‑10 ms wait
+     * they replace and the XCLR waits of comparable Sony drivers; a board
+     * whose timing has been verified can lower them. Rail ramps themselves
+     * are the regulators' own enable/ramp delays.
+     */
+    #define IMX377_RAIL_SETTLE_US   1000    /* all rails up to XCLR release */
+    #define IMX377_INCK_SETTLE_US   1000    /* INCK running to XCLR release */
+    #define IMX377_XCLR_SETTLE_US   10000   /* XCLR release to first I2C access */
+
+    static const char * const imx377_supply_names[] = {
+        "dvdd",
+        "avdd",
+        "dovdd",
+    };
+
+    #define IMX377_NUM_SUPPLIES     ARRAY_SIZE(imx377_supply_names)
+
+    /* Default idle time before a stopped sensor is powered down */
+    #define IMX377_AUTOSUSPEND_MS   1000
+
+    static int autosuspend_ms = IMX377_AUTOSUSPEND_MS;
+    module_param(autosuspend_ms, int, 0444);
+    MODULE_PARM_DESC(autosuspend_ms,
+                     "Idle time before power-down in ms, -1 = never (per device: power/autosuspend_delay_ms)");
+
+    /* How long a sync master waits for its slaves before starting anyway */
+    #define IMX377_SYNC_TIMEOUT_MS  1000
+
+    /*
+     * Idle policy. A paused sensor sits in register standby with rails and
+     * INCK up and every register intact, so the next stream‑on is a single
+     * STANDBY=0 write; autosuspend_ms still bounds how long it stays that way.
+     * Writable at runtime: it is read at each stream‑off, so a change applies
+     * from the next stop.
+     */
+    static bool idle_standby = true;
+    module_param(idle_standby, bool, 0644);
+    MODULE_PARM_DESC(idle_standby,
+                     "Pause a stopped sensor in register standby instead of stopping readout");
+
+    /* Largest payload sent in one auto‑increment write (plus 2 address bytes) */
+    #define IMX377_MAX_BURST        64
+
+    /*
+     * A register table as it goes on the bus: bursts packed back to back,
+     * each a 16‑bit start address (big‑endian), a length and that many
+     * values. The tables are compiled from imx377_tables.regs at build time
+     * by imx377-regc, which sorts and merges them into auto‑increment runs.
+     */
+    struct imx377_table {
+        u16 regs;       /* registers set */
+        u16 bursts;     /* transactions */
+        u32 size;       /* bytes of @data */
+        const u8 *data;
+    };
+
+    /* Registers of @to that still need writing when switching from @from */
+    struct imx377_delta {
+        const struct imx377_table *from;
+        const struct imx377_table *to;
+        struct imx377_table table;
+    };
+
+    /* Output formats: every mode can be read out with any of these */
+    struct imx377_format {
+        u32 code;
+        u32 bpp;
+        const struct imx377_table *table;
+    };
+
+    struct imx377_mode {
+        u32 width;
+        u32 height;
+        u32 hts;      /* line length in pixels */
+        u32 vts;      /* frame length in lines */
+        u64 link_freq;
+        u32 binning;  /* 1 = all‑pixel, 2 = 2x2 binned */
+        struct v4l2_rect crop;  /* readout window, in array pixels */
+        const struct imx377_table *table;
+    };
+
+    #include "imx377_tables.h"
+
+    static_assert(IMX377_TABLES_MAX_BURST <= IMX377_MAX_BURST);
+
+    /* Sorted by decreasing size; the first entry is the power‑on default */
+    static const struct imx377_mode imx377_modes[] = {
+        {
+            .width      = 4056,
+            .height     = 3040,
+            .hts        = 0x0172 * IMX377_HMAX_UNIT,
+            .vts        = 0x0CB2,
+            .link_freq  = IMX377_LINK_FREQ_576MHZ,
+            .binning    = 1,
+            .crop       = { 0, 0, IMX377_NATIVE_WIDTH, IMX377_NATIVE_HEIGHT },
+            .table      = &imx377_mode_4056x3040,
+        },
+        {
+            .width      = 2028,
+            .height     = 1520,
+            .hts        = 0x00C2 * IMX377_HMAX_UNIT,
+            .vts        = 0x0672,
+            .link_freq  = IMX377_LINK_FREQ_576MHZ,
+            .binning    = 2,
+            .crop       = { 0, 0, IMX377_NATIVE_WIDTH, IMX377_NATIVE_HEIGHT },
+            .table      = &imx377_mode_2028x1520,
+        },
+        {
+            .width      = 1920,
+            .height     = 1080,
+            .hts        = 0x00AF * IMX377_HMAX_UNIT,
+            .vts        = 0x05F4,
+            .link_freq  = IMX377_LINK_FREQ_576MHZ,
+            .binning    = 2,
+            .crop       = { 108, 440, 3840, 2160 },
+            .table      = &imx377_mode_1920x1080,
+        },
+    };
+
+    static const struct imx377_mode *const imx377_default_mode = &imx377_modes[0];
+
+    /* The first entry is the power‑on default */
+    static const struct imx377_format imx377_formats[] = {
+        {
+            .code       = MEDIA_BUS_FMT_SRGGB12_1X12,
+            .bpp        = 12,
+            .table      = &imx377_format_raw12,
+        },
+        {
+            .code       = MEDIA_BUS_FMT_SRGGB10_1X10,
+            .bpp        = 10,
+            .table      = &imx377_format_raw10,
+        },
+    };
+
+    /* One queued exposure/gain/VMAX set and the frame it must land on */
+    struct imx377_frame_ctrls {
+        u64  target;
+        u32  exposure;
+        u32  gain;
+        u32  vts;
+        bool exp_sent;      /* exposure and VMAX written */
+        bool gain_sent;
+    };
+
+    enum imx377_sync_mode {
+        IMX377_SYNC_NONE,       /* free‑running */
+        IMX377_SYNC_MASTER,     /* drives XVS/XHS for its group */
+        IMX377_SYNC_SLAVE,      /* locks to the group master's XVS/XHS */
+    };
+
+    /*
+     * Sensors on one adapter that also answer a common "sony,broadcast-address".
+     * members and every member's bcast_* state are under @lock; the list of
+     * coordinators is under imx377_bcast_list_lock.
+     */
+    struct imx377_bcast {
+        struct list_head        node;       /* in imx377_bcast_list */
+        unsigned int            users;
+        struct i2c_adapter      *adap;
+        u16                     addr;
+        struct i2c_client       *client;
+        struct regmap           *regmap;    /* write‑only, uncached */
+        struct mutex            lock;
+        struct list_head        members;
+    };
+
+    /* A parsed mode blob, shared by every sensor loading the same file */
+    struct imx377_fw_modes {
+        struct list_head        node;       /* in imx377_fw_list */
+        const char              *name;
+        unsigned int            users;
+        struct imx377_mode      *modes;
+        unsigned int            num_modes;
+        struct imx377_format    *formats;
+        unsigned int            num_formats;
+        struct imx377_table     *tables;    /* modes', then formats' */
+        u8                      data[];     /* the blob's burst tables */
+    };
+
+    enum imx377_io {
+        IMX377_IO_READ,
+        IMX377_IO_WRITE,
+        IMX377_IO_NR,
+    };
+
+    enum imx377_hist {
+        IMX377_HIST_WRITE,      /* one bus write, single or burst */
+        IMX377_HIST_CTRL,       /* one exposure/gain/VMAX update */
+        IMX377_HIST_POWER_ON,
+        IMX377_HIST_STREAM_ON,
+        IMX377_HIST_NR,
+    };
+
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+    /* Bucket n counts durations in [2^n, 2^(n+1)) ns; the last one is open */
+    #define IMX377_HIST_BUCKETS     32
+
+    struct imx377_stats {
+        u64 xfers[IMX377_IO_NR];
+        u64 bytes[IMX377_IO_NR];    /* address bytes included */
+        u64 errors[IMX377_IO_NR];
+        u32 hist[IMX377_HIST_NR][IMX377_HIST_BUCKETS];
+    };
+    #endif
+
+    /*
+     * Timed steps of the last probe / stream cycle, for benchmarking. The
+     * power‑on phases come first, in imx377_power_phase order.
+     */
+    enum imx377_step {
+        IMX377_STEP_TABLES = IMX377_PHASE_REGCACHE + 1, /* STANDBY + tables */
+        IMX377_STEP_WINDOW,         /* window and sync setup */
+        IMX377_STEP_CTRL_FLUSH,
+        IMX377_STEP_MODE_SELECT,
+        IMX377_STEP_STREAM_ON,      /* the whole of stream‑on */
+        IMX377_STEP_STREAM_OFF,
+        IMX377_STEP_LIVE_SWITCH,    /* standby, delta, resume */
+        IMX377_STEP_PROBE,
+        IMX377_STEP_NR,
+    };
+
+    struct imx377_latency {
+        u32 count;
+        u64 last_ns;
+        u64 min_ns;
+        u64 max_ns;
+    };
+
+    struct imx377 {
+        struct i2c_client       *client;
+        struct regmap           *regmap;
+        struct v4l2_subdev       sd;
+        struct media_pad         pad;
+
+        struct clk              *xclk;
+        struct regulator_bulk_data supplies[IMX377_NUM_SUPPLIES];
+        u32                     rail_settle_us;
+        u32                     inck_settle_us;
+        u32                     xclr_settle_us;
+        struct gpio_desc        *reset_gpio;
+        struct gpio_desc        *pwdn_gpio;
+        struct gpio_desc        *xvs_gpio;  /* optional frame‑start output */
+        int                     xvs_irq;
+        u32                     xvs_seq;    /* next frame number, hard IRQ only */
+        u32                     xvs_last_seq;
+        ktime_t                 xvs_ts;     /* start of frame xvs_last_seq */
+        struct gpio_desc        *trig_gpio; /* optional trigger input */
+        int                     trig_irq;
+        ktime_t                 trig_irq_ts;    /* edge time, hard IRQ only */
+
+        struct v4l2_ctrl_handler ctrls;
+        /* exposure cluster: committed together inside one REGHOLD window */
+        struct v4l2_ctrl        *exp_ctrl;
+        struct v4l2_ctrl        *gain_ctrl;
+        struct v4l2_ctrl        *vblank_ctrl;
+        struct v4l2_ctrl        *hblank_ctrl;
+        struct v4l2_ctrl        *pixel_rate_ctrl;
+        struct v4l2_ctrl        *link_freq_ctrl;
+        struct v4l2_ctrl        *trig_src_ctrl;
+
+        const struct imx377_mode *cur_mode;
+        const struct imx377_format *cur_fmt;
+        /* Modes and formats offered: the built‑in tables or a firmware set */
+        const struct imx377_mode *modes;
+        unsigned int            num_modes;
+        const struct imx377_format *formats;
+        unsigned int            num_formats;
+        struct imx377_fw_modes  *fw_modes;
+        const struct imx377_mode *applied_mode; /* tables held in regcache */
+        const struct imx377_format *applied_fmt;
+        struct v4l2_rect        crop;   /* active readout window */
+        u32                     vts;    /* frame length last written to VMAX */
+        struct mutex            lock;   /* protect streaming state */
+        bool                    streaming;
+        bool                    paused;         /* STANDBY=1, MODE_SELECT still 1 */
+        bool                    resume_dirty;   /* state changed since the pause */
+        bool                    ctrls_held;     /* s_ctrl keeps values, writes nothing */
+        ktime_t                 frame_base;     /* start of frame frame_base_seq */
+        u64                     frame_base_seq;
+        u64                     frame_ns;
+
+        /*
+         * Per‑frame control queue. queue_lock (nests inside lock) covers the
+         * queue and, while streaming, vts and the frame timeline above.
+         */
+        struct mutex            queue_lock;
+        struct imx377_frame_ctrls queue[IMX377_CTRL_QUEUE_LEN];
+        unsigned int            queue_head;
+        unsigned int            queue_len;
+        bool                    ticking;
+        struct hrtimer          frame_timer;
+        struct work_struct      frame_work;
+
+        /*
+         * Trigger mode, also under queue_lock (trig_armed only changes with
+         * lock held too); the timeline is idle then.
+         */
+        enum v4l2_imx377_trigger_source trig_armed; /* OFF unless armed */
+        bool                    trig_busy;      /* a triggered frame is out */
+        ktime_t                 trig_ts;        /* the trigger that started it */
+        u32                     trig_count;
+        u32                     trig_dropped;   /* came in during a frame */
+        struct imx377_latency   trig_lat;       /* trigger to STANDBY=0 sent */
+        struct imx377_latency   trig_xvs_lat;   /* trigger to frame start */
+
+        /* Multi‑sensor sync; sync_node, sync_armed and skew under imx377_sync_lock */
+        enum imx377_sync_mode   sync_mode;
+        u32                     sync_group;
+        struct list_head        sync_node;
+        bool                    sync_armed;     /* slave streaming, waiting for XVS */
+        bool                    sync_pending;   /* master held until slaves arm */
+        struct delayed_work     sync_work;      /* release, or give up on slaves */
+        s64                     sync_skew_ns;   /* slave XVS minus master XVS */
+        s64                     sync_skew_max_ns;
+
+        /* Broadcast table writes; bcast_node and the rest under bcast->lock */
+        struct imx377_bcast     *bcast;
+        struct list_head        bcast_node;
+        bool                    bcast_powered;
+        bool                    bcast_busy;     /* streaming: no broadcasts */
+        bool                    bcast_touched;  /* a peer broadcast since power‑on */
+        const struct imx377_mode *bcast_mode;   /* what it left, NULL if failed */
+        const struct imx377_format *bcast_fmt;
+        u32                     bcast_sent;     /* broadcast transactions */
+        u32                     bcast_received; /* table sets taken from peers */
+        u32                     bcast_saved;    /* unicast transactions skipped */
+
+        struct dentry           *debugfs;
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+        struct imx377_stats __percpu *stats;
+    #endif
+        u32                     ctrl_updates;
+        u32                     missed_updates; /* straddled a frame boundary */
+        struct imx377_latency   stream_on_lat[2];   /* [0] warm, [1] cold */
+        struct imx377_latency   power_on_lat;
+        u64                     step_ns[IMX377_STEP_NR];    /* under lock */
+    };
+
+    /* ------------------------------------------------------------------ */
+    /* Register map                                                        */
+    /* ------------------------------------------------------------------ */
+
+    static const struct regmap_range imx377_rw_ranges[] = {
+        regmap_reg_range(IMX377_REG_MODE_SELECT, IMX377_REG_MODE_SELECT),
+        regmap_reg_range(IMX377_STANDBY, IMX377_REG_LAST),
+    };
+
+    static const struct regmap_access_table imx377_rw_table = {
+        .yes_ranges   = imx377_rw_ranges,
+        .n_yes_ranges = ARRAY_SIZE(imx377_rw_ranges),
+    };
+
+    /*
+     * STANDBY, REGHOLD, XMSTA and MODE_SELECT follow the power state rather than
+     * what we last wrote, and must never be replayed by regcache_sync() (that
+     * would start streaming straight out of power‑on), so keep them out of
+     * the cache.
+     */
+    static const struct regmap_range imx377_volatile_ranges[] = {
+        regmap_reg_range(IMX377_REG_MODE_SELECT, IMX377_REG_MODE_SELECT),
+        regmap_reg_range(IMX377_STANDBY, IMX377_REG_XMSTA),
+    };
+
+    static const struct regmap_access_table imx377_volatile_table = {
+        .yes_ranges   = imx377_volatile_ranges,
+        .n_yes_ranges = ARRAY_SIZE(imx377_volatile_ranges),
+    };
+
+    /*
+     * Registers the driver sequences itself: start/stop, per‑frame controls
+     * (VMAX included, it follows VBLANK), sync and window. Mode tables must
+     * leave them alone; this is the "reserved" set of imx377_tables.regs,
+     * enforced on loaded tables.
+     */
+    static const struct regmap_range imx377_reserved_ranges[] = {
+        regmap_reg_range(IMX377_REG_MODE_SELECT, IMX377_REG_MODE_SELECT),
+        regmap_reg_range(IMX377_STANDBY, IMX377_REG_XMSTA),
+        regmap_reg_range(IMX377_REG_GAIN_H, IMX377_REG_EXPOSURE_L),
+        regmap_reg_range(IMX377_REG_VMAX_H, IMX377_REG_VMAX_L),
+        regmap_reg_range(IMX377_REG_SYNCSEL, IMX377_REG_SYNCSEL),
+        regmap_reg_range(IMX377_REG_WINPH_H, IMX377_REG_WINWV_L),
+    };
+
+    static const struct regmap_config imx377_regmap_config = {
+        .reg_bits       = 16,
+        .val_bits       = 8,
+        .max_register   = IMX377_REG_LAST,
+        .rd_table       = &imx377_rw_table,
+        .wr_table       = &imx377_rw_table,
+        .volatile_table = &imx377_volatile_table,
+        .cache_type     = REGCACHE_MAPLE,
+    };
+
+    /* ------------------------------------------------------------------ */
+    /* Statistics                                                          */
+    /* ------------------------------------------------------------------ */
+
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+    static inline ktime_t imx377_stats_time(void)
+    {
+        return ktime_get();
+    }
+
+    static void imx377_stats_since(struct imx377 *priv, enum imx377_hist h,
+                                   ktime_t t0)
+    {
+        u64 ns = ktime_to_ns(ktime_sub(ktime_get(), t0));
+        unsigned int b = ns ? min_t(unsigned int, ilog2(ns),
+                                    IMX377_HIST_BUCKETS - 1) : 0;
+
+        this_cpu_inc(priv->stats->hist[h][b]);
+    }
+
+    /* One bus transaction of @len data bytes, begun at @t0 */
+    static void imx377_stats_io(struct imx377 *priv, enum imx377_io dir,
+                                u32 len, int ret, ktime_t t0)
+    {
+        this_cpu_inc(priv->stats->xfers[dir]);
+        this_cpu_add(priv->stats->bytes[dir], len + 2);
+        if (ret)
+            this_cpu_inc(priv->stats->errors[dir]);
+        if (dir == IMX377_IO_WRITE)
+            imx377_stats_since(priv, IMX377_HIST_WRITE, t0);
+    }
+    #else
+    static inline ktime_t imx377_stats_time(void)
+    {
+        return 0;
+    }
+
+    static inline void imx377_stats_since(struct imx377 *priv,
+                                          enum imx377_hist h, ktime_t t0)
+    {
+    }
+
+    static inline void imx377_stats_io(struct imx377 *priv, enum imx377_io dir,
+                                       u32 len, int ret, ktime_t t0)
+    {
+    }
+    #endif
+
+    /* ------------------------------------------------------------------ */
+    /* Register helpers                                                    */
+    /* ------------------------------------------------------------------ */
+
+    /* Cached write: the bus is skipped when the sensor already holds @val */
+    static int imx377_write_reg(struct imx377 *priv, u16 reg, u8 val)
+    {
+        ktime_t t0 = imx377_stats_time();
+        bool change = false;
+        int ret;
+
+        ret = regmap_update_bits_check(priv->regmap, reg, 0xff, val, &change);
+        if (ret || change)
+            imx377_stats_io(priv, IMX377_IO_WRITE, 1, ret, t0);
+        return ret;
+    }
+
+    /* Uncached write for the volatile start/stop registers: always sent */
+    static int imx377_write_volatile(struct imx377 *priv, u16 reg, u8 val)
+    {
+        ktime_t t0 = imx377_stats_time();
+        int ret;
+
+        ret = regmap_write(priv->regmap, reg, val);
+        imx377_stats_io(priv, IMX377_IO_WRITE, 1, ret, t0);
+        return ret;
+    }
+
+    /*
+     * One auto‑increment transfer: 16‑bit start address followed by @len
+     * values, through @map (the sensor's own or a broadcast regmap). Every
+     * burst goes through here, accounted to @priv; a NULL @priv marks a
+     * cache‑only write that never reaches the bus. The clock is only read
+     * while statistics or the trace event need it.
+     */
+    static int imx377_bulk_write(struct imx377 *priv, struct regmap *map,
+                                 u16 reg, const u8 *vals, u32 len)
+    {
+        ktime_t t0 = 0;
+        int ret;
+
+        if (priv && (IS_ENABLED(CONFIG_VIDEO_IMX377_STATS) ||
+                     trace_imx377_burst_enabled()))
+            t0 = ktime_get();
+        ret = regmap_bulk_write(map, reg, vals, len);
+        if (!priv)
+            return ret;
+
+        imx377_stats_io(priv, IMX377_IO_WRITE, len, ret, t0);
+        if (t0 && trace_imx377_burst_enabled())
+            trace_imx377_burst(to_i2c_client(regmap_get_device(map)), reg, len,
+                               ktime_to_ns(ktime_sub(ktime_get(), t0)), ret);
+        return ret;
+    }
+
+    static int imx377_write_burst(struct imx377 *priv, u16 reg,
+                                  const u8 *vals, u32 len)
+    {
+        return imx377_bulk_write(priv, priv->regmap, reg, vals, len);
+    }
+
+    /*
+     * Send a compiled table, one transaction per burst; returns the bursts
+     * sent. @priv is charged for them, as in imx377_bulk_write().
+     */
+    static int __imx377_write_table(struct imx377 *priv, struct regmap *map,
+                                    const struct imx377_table *table)
+    {
+        const u8 *p = table->data, *end = p + table->size;
+        int ret;
+
+        while (p < end) {
+            ret = imx377_bulk_write(priv, map, p[0] << 8 | p[1], p + 3, p[2]);
+            if (ret)
+                return ret;
+            p += 3 + p[2];
+        }
+        return table->bursts;
+    }
+
+    /* The compiled delta between two modes, or NULL to send the whole table */
+    static const struct imx377_table *
+    imx377_mode_delta(const struct imx377_mode *from, const struct imx377_mode *to)
+    {
+        unsigned int i;
+
+        for (i = 0; i < ARRAY_SIZE(imx377_mode_deltas); i++)
+            if (imx377_mode_deltas[i].from == from->table &&
+                imx377_mode_deltas[i].to == to->table)
+                return &imx377_mode_deltas[i].table;
+        return NULL;
+    }
+
+    /* Mode then format table; returns the number of bursts */
+    static int imx377_write_tables(struct imx377 *priv, struct regmap *map,
+                                   const struct imx377_mode *mode,
+                                   const struct imx377_format *fmt)
+    {
+        int n, m;
+
+        n = __imx377_write_table(priv, map, mode->table);
+        if (n < 0)
+            return n;
+        m = __imx377_write_table(priv, map, fmt->table);
+        return m < 0 ? m : n + m;
+    }
+
+    /* Readout window: eight adjacent registers, one burst */
+    static int imx377_write_window(struct imx377 *priv, const struct v4l2_rect *r)
+    {
+        u8 vals[8] = {
+            r->left >> 8,  r->left & 0xFF,
+            r->width >> 8, r->width & 0xFF,
+            r->top >> 8,   r->top & 0xFF,
+            r->height >> 8, r->height & 0xFF,
+        };
+
+        return imx377_write_burst(priv, IMX377_REG_WINPH_H, vals, sizeof(vals));
+    }
+
+    static int imx377_write_vmax(struct imx377 *priv, u32 vts)
+    {
+        u8 vals[2] = { (vts >> 8) & 0xFF, vts & 0xFF };
+
+        return imx377_write_burst(priv, IMX377_REG_VMAX_H, vals, sizeof(vals));
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Frame timing                                                        */
+    /* ------------------------------------------------------------------ */
+
+    static u64 imx377_frame_ns(const struct imx377_mode *mode, u32 vts)
+    {
+        return div64_u64((u64)mode->hts * vts * NSEC_PER_SEC, IMX377_PIXEL_RATE);
+    }
+
+    /*
+     * Readout time scales with the lines actually read, so a shorter window
+     * keeps the mode's vertical blanking and drops the frame length with it.
+     */
+    static u32 imx377_crop_vts(const struct imx377_mode *mode,
+                               const struct v4l2_rect *crop)
+    {
+        return mode->vts - mode->crop.height / mode->binning +
+               crop->height / mode->binning;
+    }
+
+    static void imx377_frame_interval(const struct imx377_mode *mode, u32 vts,
+                                      struct v4l2_fract *fi)
+    {
+        u64 num = (u64)mode->hts * vts;
+        u64 den = IMX377_PIXEL_RATE;
+        unsigned long g = gcd((unsigned long)num, (unsigned long)den);
+
+        fi->numerator = div_u64(num, g);
+        fi->denominator = div_u64(den, g);
+    }
+
+    /* Frame length giving @fi, clamped to what the mode can do */
+    static u32 imx377_interval_vts(const struct imx377_mode *mode, u32 min_vts,
+                                   const struct v4l2_fract *fi)
+    {
+        u64 vts;
+
+        if (!fi->numerator || !fi->denominator)
+            return min_vts;
+
+        vts = div_u64(mul_u64_u32_div(IMX377_PIXEL_RATE, fi->numerator,
+                                      fi->denominator),
+                      mode->hts);
+        return clamp_t(u64, vts, min_vts, IMX377_VTS_MAX);
+    }
+
+    /* Frames since stream‑on, estimated from the programmed frame period */
+    static u64 imx377_frame_seq(struct imx377 *priv)
+    {
+        s64 dt = ktime_to_ns(ktime_sub(ktime_get(), priv->frame_base));
+
+        if (dt < 0)
+            return priv->frame_base_seq - 1;
+        return priv->frame_base_seq + div64_u64(dt, priv->frame_ns);
+    }
+
+    /* A new VMAX takes effect from the next frame on */
+    static void imx377_rebase_frames(struct imx377 *priv, u64 frame_ns)
+    {
+        u64 seq = imx377_frame_seq(priv) + 1;
+
+        priv->frame_base = ktime_add_ns(priv->frame_base,
+                                        (seq - priv->frame_base_seq) * priv->frame_ns);
+        priv->frame_base_seq = seq;
+        priv->frame_ns = frame_ns;
+    }
+
+    static int imx377_apply_tables(struct imx377 *priv)
+    {
+        int ret;
+
+        if (priv->applied_mode == priv->cur_mode &&
+            priv->applied_fmt == priv->cur_fmt)
+            return 0;
+
+        ret = imx377_write_tables(priv, priv->regmap, priv->cur_mode,
+                                  priv->cur_fmt);
+        if (ret < 0) {
+            priv->applied_mode = NULL;
+            return ret;
+        }
+        priv->applied_mode = priv->cur_mode;
+        priv->applied_fmt = priv->cur_fmt;
+        return 0;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Broadcast table writes                                              */
+    /* ------------------------------------------------------------------ */
+
+    /*
+     * Identical sensors on one adapter that the board also makes answer a
+     * common "sony,broadcast-address" share one coordinator. Whoever streams
+     * first sends the mode and format tables once to that address; every
+     * powered, idle peer takes them too and only has to update its own
+     * regcache when it starts. Broadcasts never go out while any peer
+     * streams, since the tables would reprogram it. Windows, sync and
+     * controls stay per sensor. Each coordinator has its own lock, so
+     * sensors on other buses or addresses never wait for each other.
+     */
+    static LIST_HEAD(imx377_bcast_list);
+    static DEFINE_MUTEX(imx377_bcast_list_lock);
+
+    static const struct regmap_config imx377_bcast_regmap_config = {
+        .reg_bits       = 16,
+        .val_bits       = 8,
+        .max_register   = IMX377_REG_LAST,
+        .wr_table       = &imx377_rw_table,
+        .cache_type     = REGCACHE_NONE,
+    };
+
+    /* Record what the sensor holds without touching the bus */
+    static int imx377_cache_tables(struct imx377 *priv,
+                                   const struct imx377_mode *mode,
+                                   const struct imx377_format *fmt)
+    {
+        int n;
+
+        regcache_cache_only(priv->regmap, true);
+        n = imx377_write_tables(NULL, priv->regmap, mode, fmt);
+        regcache_cache_only(priv->regmap, false);
+        return n;
+    }
+
+    /* Stream‑on: bring the tables in, by broadcast when every peer is idle */
+    static int imx377_bcast_tables(struct imx377 *priv)
+    {
+        struct imx377_bcast *b = priv->bcast;
+        struct imx377 *p;
+        int n, ret = 0;
+
+        mutex_lock(&b->lock);
+
+        /* A peer's broadcast changed our tables behind the regcache */
+        if (priv->bcast_touched) {
+            priv->bcast_touched = false;
+            priv->applied_mode = NULL;
+            if (priv->bcast_mode == priv->cur_mode &&
+                priv->bcast_fmt == priv->cur_fmt) {
+                n = imx377_cache_tables(priv, priv->cur_mode, priv->cur_fmt);
+                if (n >= 0) {
+                    priv->applied_mode = priv->cur_mode;
+                    priv->applied_fmt = priv->cur_fmt;
+                    priv->bcast_received++;
+                    priv->bcast_saved += n;
+                }
+            }
+        }
+
+        if (priv->applied_mode == priv->cur_mode &&
+            priv->applied_fmt == priv->cur_fmt)
+            goto out;
+
+        list_for_each_entry(p, &b->members, bcast_node) {
+            if (p != priv && p->bcast_busy) {
+                ret = imx377_apply_tables(priv);
+                goto out;
+            }
+        }
+
+        n = imx377_write_tables(priv, b->regmap, priv->cur_mode, priv->cur_fmt);
+        list_for_each_entry(p, &b->members, bcast_node) {
+            if (p == priv || !p->bcast_powered)
+                continue;
+            p->bcast_touched = true;
+            p->bcast_mode = n < 0 ? NULL : priv->cur_mode;
+            p->bcast_fmt = n < 0 ? NULL : priv->cur_fmt;
+        }
+        if (n < 0) {
+            priv->applied_mode = NULL;
+            ret = n;
+            goto out;
+        }
+        priv->bcast_sent += n;
+
+        ret = imx377_cache_tables(priv, priv->cur_mode, priv->cur_fmt);
+        if (ret < 0) {
+            priv->applied_mode = NULL;
+            goto out;
+        }
+        priv->applied_mode = priv->cur_mode;
+        priv->applied_fmt = priv->cur_fmt;
+        ret = 0;
+    out:
+        mutex_unlock(&b->lock);
+        return ret;
+    }
+
+    /*
+     * Streaming (or armed) sensors must not be reprogrammed by a peer. Set
+     * before stream‑on looks at bcast_touched, so no broadcast can slip in
+     * between.
+     */
+    static void imx377_bcast_busy(struct imx377 *priv, bool busy)
+    {
+        if (!priv->bcast)
+            return;
+
+        mutex_lock(&priv->bcast->lock);
+        priv->bcast_busy = busy;
+        mutex_unlock(&priv->bcast->lock);
+    }
+
+    /*
+     * Only powered sensors hear a broadcast; power‑off forgets what they
+     * heard. The regcache replay at power‑on runs under the coordinator
+     * lock, so a broadcast cannot land halfway through it: one before it is
+     * overwritten by the replay, one after it is recorded.
+     */
+    static int imx377_bcast_sync(struct imx377 *priv)
+    {
+        int ret;
+
+        if (!priv->bcast)
+            return regcache_sync(priv->regmap);
+
+        mutex_lock(&priv->bcast->lock);
+        ret = regcache_sync(priv->regmap);
+        priv->bcast_powered = !ret;
+        priv->bcast_touched = false;
+        mutex_unlock(&priv->bcast->lock);
+        return ret;
+    }
+
+    static void imx377_bcast_power_off(struct imx377 *priv)
+    {
+        if (!priv->bcast)
+            return;
+
+        mutex_lock(&priv->bcast->lock);
+        priv->bcast_powered = false;
+        priv->bcast_touched = false;
+        mutex_unlock(&priv->bcast->lock);
+    }
+
+    static int imx377_bcast_get(struct imx377 *priv)
+    {
+        struct i2c_client *client = priv->client;
+        struct imx377_bcast *b;
+        u32 addr;
+        int ret;
+
+        if (device_property_read_u32(&client->dev, "sony,broadcast-address", &addr))
+            return 0;
+        if (addr == client->addr)
+            return dev_err_probe(&client->dev, -EINVAL,
+                                 "broadcast address 0x%02x is the device address\n",
+                                 addr);
+
+        mutex_lock(&imx377_bcast_list_lock);
+        list_for_each_entry(b, &imx377_bcast_list, node)
+            if (b->adap == client->adapter && b->addr == addr)
+                goto join;
+
+        b = kzalloc(sizeof(*b), GFP_KERNEL);
+        if (!b) {
+            ret = -ENOMEM;
+            goto err_unlock;
+        }
+        b->adap = client->adapter;
+        b->addr = addr;
+        mutex_init(&b->lock);
+        INIT_LIST_HEAD(&b->members);
+
+        b->client = i2c_new_dummy_device(client->adapter, addr);
+        if (IS_ERR(b->client)) {
+            ret = PTR_ERR(b->client);
+            goto err_free;
+        }
+        b->regmap = regmap_init_i2c(b->client, &imx377_bcast_regmap_config);
+        if (IS_ERR(b->regmap)) {
+            ret = PTR_ERR(b->regmap);
+            goto err_client;
+        }
+        list_add_tail(&b->node, &imx377_bcast_list);
+    join:
+        b->users++;
+        mutex_lock(&b->lock);
+        list_add_tail(&priv->bcast_node, &b->members);
+        mutex_unlock(&b->lock);
+        priv->bcast = b;
+        mutex_unlock(&imx377_bcast_list_lock);
+        return 0;
+
+    err_client:
+        i2c_unregister_device(b->client);
+    err_free:
+        kfree(b);
+    err_unlock:
+        mutex_unlock(&imx377_bcast_list_lock);
+        return dev_err_probe(&client->dev, ret,
+                             "failed to set up broadcast address 0x%02x\n", addr);
+    }
+
+    static void imx377_bcast_put(struct imx377 *priv)
+    {
+        struct imx377_bcast *b = priv->bcast;
+
+        if (!b)
+            return;
+
+        mutex_lock(&imx377_bcast_list_lock);
+        mutex_lock(&b->lock);
+        list_del(&priv->bcast_node);
+        mutex_unlock(&b->lock);
+        priv->bcast = NULL;
+        if (!--b->users) {
+            list_del(&b->node);
+            regmap_exit(b->regmap);
+            i2c_unregister_device(b->client);
+            mutex_destroy(&b->lock);
+            kfree(b);
+        }
+        mutex_unlock(&imx377_bcast_list_lock);
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Firmware mode tables                                                */
+    /* ------------------------------------------------------------------ */
+
+    /*
+     * Optional mode set loaded at probe ("firmware-name", default below),
+     * replacing the built‑in modes and formats. Little‑endian throughout:
+     * the header, num_modes mode records, then num_formats format records,
+     * each record directly followed by table_size bytes of register bursts
+     * in the imx377_tables.h layout (16‑bit big‑endian address, length,
+     * values). @crc is the CRC‑32 of everything after the header.
+     */
+    #define IMX377_FW_NAME          "imx377-modes.bin"
+    #define IMX377_FW_MAGIC         0x37373349      /* "I377" */
+    #define IMX377_FW_VERSION       1
+
+    struct imx377_fw_header {
+        __le32 magic;
+        __le16 version;
+        __le16 num_modes;
+        __le16 num_formats;
+        __le16 reserved;
+        __le32 crc;
+    } __packed;
+
+    struct imx377_fw_mode {
+        __le16 width;
+        __le16 height;
+        __le32 hts;
+        __le32 vts;
+        __le64 link_freq;
+        __le16 binning;
+        __le16 crop_left;
+        __le16 crop_top;
+        __le16 crop_width;
+        __le16 crop_height;
+        __le16 table_size;
+    } __packed;
+
+    struct imx377_fw_format {
+        __le32 code;
+        __le16 bpp;
+        __le16 table_size;
+    } __packed;
+
+    static LIST_HEAD(imx377_fw_list);
+    static DEFINE_MUTEX(imx377_fw_lock);
+
+    /* Check one table's bursts and fill in its counts */
+    static int imx377_fw_table(struct device *dev, const u8 *data, u32 size,
+                               struct imx377_table *t)
+    {
+        const u8 *p = data, *end = data + size;
+        u32 addr, len, i;
+
+        t->regs = 0;
+        t->bursts = 0;
+        while (p < end) {
+            if (end - p < 3 || !p[2] || p[2] > IMX377_MAX_BURST ||
+                end - p - 3 < p[2])
+                goto bad;
+            addr = p[0] << 8 | p[1];
+            len = p[2];
+            for (i = addr; i < addr + len; i++) {
+                if (!regmap_reg_in_ranges(i, imx377_rw_ranges,
+                                          ARRAY_SIZE(imx377_rw_ranges))) {
+                    dev_err(dev, "mode table sets unknown register 0x%04x\n", i);
+                    return -EINVAL;
+                }
+                if (regmap_reg_in_ranges(i, imx377_reserved_ranges,
+                                         ARRAY_SIZE(imx377_reserved_ranges))) {
+                    dev_err(dev, "mode table sets reserved register 0x%04x\n", i);
+                    return -EINVAL;
+                }
+            }
+            t->regs += len;
+            t->bursts++;
+            p += 3 + len;
+        }
+        t->size = size;
+        t->data = size ? data : NULL;
+        return 0;
+
+    bad:
+        dev_err(dev, "malformed burst at table offset %td\n", p - data);
+        return -EINVAL;
+    }
+
+    /* Only the formats the sensor has, at their own depth */
+    static int imx377_fw_check_format(struct device *dev, const struct imx377_format *f)
+    {
+        unsigned int i;
+
+        for (i = 0; i < ARRAY_SIZE(imx377_formats); i++)
+            if (imx377_formats[i].code == f->code &&
+                imx377_formats[i].bpp == f->bpp)
+                return 0;
+
+        dev_err(dev, "unsupported format 0x%04x at %u bpp\n", f->code, f->bpp);
+        return -EINVAL;
+    }
+
+    static int imx377_fw_check_mode(struct device *dev, const struct imx377_mode *m)
+    {
+        const struct v4l2_rect *c = &m->crop;
+        unsigned int i;
+
+        if (m->binning != 1 && m->binning != 2)
+            goto bad;
+        if (c->left < 0 || c->top < 0 || !c->width || !c->height ||
+            c->left + c->width > IMX377_NATIVE_WIDTH ||
+            c->top + c->height > IMX377_NATIVE_HEIGHT)
+            goto bad;
+        if (c->width / m->binning != m->width ||
+            c->height / m->binning != m->height)
+            goto bad;
+        if (m->hts < m->width || m->vts <= m->height || m->vts > IMX377_VTS_MAX)
+            goto bad;
+        for (i = 0; i < ARRAY_SIZE(imx377_link_freqs); i++)
+            if (imx377_link_freqs[i] == m->link_freq)
+                return 0;
+    bad:
+        dev_err(dev, "invalid mode %ux%u\n", m->width, m->height);
+        return -EINVAL;
+    }
+
+    static void imx377_fw_free(struct imx377_fw_modes *fm)
+    {
+        kfree(fm->modes);
+        kfree(fm->formats);
+        kfree(fm->tables);
+        kfree(fm->name);
+        kfree(fm);
+    }
+
+    /* Validate @fw once and build the mode and format arrays over a copy of it */
+    static struct imx377_fw_modes *imx377_fw_parse(struct device *dev,
+                                                   const char *name,
+                                                   const struct firmware *fw)
+    {
+        const struct imx377_fw_header *hdr = (const void *)fw->data;
+        unsigned int nm, nf, i;
+        struct imx377_fw_modes *fm;
+        size_t off, payload;
+        int ret = -EINVAL;
+
+        if (fw->size < sizeof(*hdr) || le32_to_cpu(hdr->magic) != IMX377_FW_MAGIC) {
+            dev_err(dev, "%s: not an IMX377 mode file\n", name);
+            return ERR_PTR(-EINVAL);
+        }
+        if (le16_to_cpu(hdr->version) != IMX377_FW_VERSION) {
+            dev_err(dev, "%s: version %u, expected %u\n", name,
+                    le16_to_cpu(hdr->version), IMX377_FW_VERSION);
+            return ERR_PTR(-EINVAL);
+        }
+        payload = fw->size - sizeof(*hdr);
+        if ((crc32_le(~0, fw->data + sizeof(*hdr), payload) ^ ~0) !=
+            le32_to_cpu(hdr->crc)) {
+            dev_err(dev, "%s: CRC mismatch\n", name);
+            return ERR_PTR(-EINVAL);
+        }
+        nm = le16_to_cpu(hdr->num_modes);
+        nf = le16_to_cpu(hdr->num_formats);
+        if (!nm || !nf) {
+            dev_err(dev, "%s: no modes or no formats\n", name);
+            return ERR_PTR(-EINVAL);
+        }
+
+        fm = kzalloc(struct_size(fm, data, payload), GFP_KERNEL);
+        if (!fm)
+            return ERR_PTR(-ENOMEM);
+        fm->modes = kcalloc(nm, sizeof(*fm->modes), GFP_KERNEL);
+        fm->formats = kcalloc(nf, sizeof(*fm->formats), GFP_KERNEL);
+        fm->tables = kcalloc(nm + nf, sizeof(*fm->tables), GFP_KERNEL);
+        fm->name = kstrdup(name, GFP_KERNEL);
+        if (!fm->modes || !fm->formats || !fm->tables || !fm->name) {
+            ret = -ENOMEM;
+            goto err;
+        }
+        memcpy(fm->data, fw->data + sizeof(*hdr), payload);
+
+        /* Tables point into fm->data, so stream‑on walks them as they are */
+        for (off = 0, i = 0; i < nm; i++) {
+            const struct imx377_fw_mode *rec = (const void *)(fm->data + off);
+            struct imx377_mode *m = &fm->modes[i];
+            u32 size;
+
+            if (payload - off < sizeof(*rec))
+                goto truncated;
+            size = le16_to_cpu(rec->table_size);
+            off += sizeof(*rec);
+            if (payload - off < size)
+                goto truncated;
+
+            m->width = le16_to_cpu(rec->width);
+            m->height = le16_to_cpu(rec->height);
+            m->hts = le32_to_cpu(rec->hts);
+            m->vts = le32_to_cpu(rec->vts);
+            m->link_freq = le64_to_cpu(rec->link_freq);
+            m->binning = le16_to_cpu(rec->binning);
+            m->crop.left = le16_to_cpu(rec->crop_left);
+            m->crop.top = le16_to_cpu(rec->crop_top);
+            m->crop.width = le16_to_cpu(rec->crop_width);
+            m->crop.height = le16_to_cpu(rec->crop_height);
+            ret = imx377_fw_check_mode(dev, m);
+            if (ret)
+                goto err;
+
+            m->table = &fm->tables[i];
+            ret = imx377_fw_table(dev, fm->data + off, size, &fm->tables[i]);
+            if (ret)
+                goto err;
+            off += size;
+        }
+
+        for (i = 0; i < nf; i++) {
+            const struct imx377_fw_format *rec = (const void *)(fm->data + off);
+            struct imx377_format *f = &fm->formats[i];
+            u32 size;
+
+            if (payload - off < sizeof(*rec))
+                goto truncated;
+            size = le16_to_cpu(rec->table_size);
+            off += sizeof(*rec);
+            if (payload - off < size)
+                goto truncated;
+
+            f->code = le32_to_cpu(rec->code);
+            f->bpp = le16_to_cpu(rec->bpp);
+            ret = imx377_fw_check_format(dev, f);
+            if (ret)
+                goto err;
+
+            f->table = &fm->tables[nm + i];
+            ret = imx377_fw_table(dev, fm->data + off, size, &fm->tables[nm + i]);
+            if (ret)
+                goto err;
+            off += size;
+        }
+
+        if (off != payload)
+            goto truncated;
+
+        fm->num_modes = nm;
+        fm->num_formats = nf;
+        return fm;
+
+    truncated:
+        dev_err(dev, "%s: truncated or trailing data\n", name);
+        ret = -EINVAL;
+    err:
+        imx377_fw_free(fm);
+        return ERR_PTR(ret);
+    }
+
+    static void imx377_fw_modes_put(void *data)
+    {
+        struct imx377 *priv = data;
+        struct imx377_fw_modes *fm = priv->fw_modes;
+
+        mutex_lock(&imx377_fw_lock);
+        if (!--fm->users) {
+            list_del(&fm->node);
+            imx377_fw_free(fm);
+        }
+        mutex_unlock(&imx377_fw_lock);
+        priv->fw_modes = NULL;
+    }
+
+    /*
+     * Use the mode file if there is one: parsed once, then shared by every
+     * sensor naming the same file. A missing or rejected file leaves the
+     * built‑in modes in place.
+     */
+    static int imx377_fw_modes_get(struct imx377 *priv)
+    {
+        struct device *dev = &priv->client->dev;
+        const char *name = IMX377_FW_NAME;
+        const struct firmware *fw;
+        struct imx377_fw_modes *fm;
+        int ret;
+
+        priv->modes = imx377_modes;
+        priv->num_modes = ARRAY_SIZE(imx377_modes);
+        priv->formats = imx377_formats;
+        priv->num_formats = ARRAY_SIZE(imx377_formats);
+
+        device_property_read_string(dev, "firmware-name", &name);
+
+        mutex_lock(&imx377_fw_lock);
+        list_for_each_entry(fm, &imx377_fw_list, node)
+            if (!strcmp(fm->name, name))
+                goto found;
+
+        if (firmware_request_nowarn(&fw, name, dev)) {
+            mutex_unlock(&imx377_fw_lock);
+            dev_dbg(dev, "no %s, using built-in modes\n", name);
+            return 0;
+        }
+        fm = imx377_fw_parse(dev, name, fw);
+        release_firmware(fw);
+        if (IS_ERR(fm)) {
+            mutex_unlock(&imx377_fw_lock);
+            dev_warn(dev, "%s rejected (%pe), using built-in modes\n", name, fm);
+            return 0;
+        }
+        list_add_tail(&fm->node, &imx377_fw_list);
+        dev_info(dev, "%u modes, %u formats from %s\n", fm->num_modes,
+                 fm->num_formats, name);
+    found:
+        fm->users++;
+        mutex_unlock(&imx377_fw_lock);
+
+        priv->fw_modes = fm;
+        ret = devm_add_action_or_reset(dev, imx377_fw_modes_put, priv);
+        if (ret)
+            return ret;
+
+        priv->modes = fm->modes;
+        priv->num_modes = fm->num_modes;
+        priv->formats = fm->formats;
+        priv->num_formats = fm->num_formats;
+        return 0;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Power management                                                    */
+    /* ------------------------------------------------------------------ */
+
+    static void imx377_latency_add(struct imx377_latency *lat, u64 ns)
+    {
+        if (!lat->count || ns < lat->min_ns)
+            lat->min_ns = ns;
+        if (ns > lat->max_ns)
+            lat->max_ns = ns;
+        lat->last_ns = ns;
+        lat->count++;
+    }
+
+    /*
+     * Close a power phase begun at @t0 and return the start of the next.
+     * Phases are only timed while the trace event is on; one whose start
+     * was not timed (@t0 == 0) is skipped.
+     */
+    static ktime_t imx377_trace_power(struct imx377 *priv, bool on,
+                                      enum imx377_power_phase phase, ktime_t t0)
+    {
+        ktime_t now;
+        u64 ns;
+
+        if (!trace_imx377_power_enabled())
+            return t0;
+
+        now = ktime_get();
+        if (t0) {
+            ns = ktime_to_ns(ktime_sub(now, t0));
+            trace_imx377_power(priv->client, on, phase, ns);
+            if (on)
+                priv->step_ns[phase] = ns;
+        }
+        return now;
+    }
+
+    static void imx377_sleep_until(ktime_t deadline)
+    {
+        s64 us = ktime_us_delta(deadline, ktime_get());
+
+        if (us > 0)
+            fsleep(us);
+    }
+
+    /*
+     * Rails come up together, INCK starts as soon as they are enabled, and
+     * the two settle times run concurrently: XCLR is released at whichever
+     * deadline is later, then the sensor gets its own time before I2C.
+     */
+    static int imx377_power_on(struct imx377 *priv)
+    {
+        ktime_t t0 = ktime_get(), rails, inck, xclr;
+        ktime_t t = trace_imx377_power_enabled() ? t0 : 0;
+        int ret;
+
+        /* The settle deadlines count from these, traced or not */
+        ret = regulator_bulk_enable(IMX377_NUM_SUPPLIES, priv->supplies);
+        if (ret)
+            return ret;
+        rails = ktime_get();
+        t = imx377_trace_power(priv, true, IMX377_PHASE_REGULATORS, t);
+
+        ret = clk_prepare_enable(priv->xclk);
+        if (ret)
+            goto disable_supplies;
+        inck = ktime_get();
+        t = imx377_trace_power(priv, true, IMX377_PHASE_CLOCK, t);
+
+        xclr = ktime_add_us(rails, priv->rail_settle_us);
+        if (ktime_before(xclr, ktime_add_us(inck, priv->inck_settle_us)))
+            xclr = ktime_add_us(inck, priv->inck_settle_us);
+        imx377_sleep_until(xclr);
+        t = imx377_trace_power(priv, true, IMX377_PHASE_SETTLE, t);
+
+        /* reset-gpios is XCLR, active low: 0 releases the sensor */
+        if (priv->reset_gpio)
+            gpiod_set_value_cansleep(priv->reset_gpio, 0);
+        if (priv->pwdn_gpio)
+            gpiod_set_value_cansleep(priv->pwdn_gpio, 0);
+        fsleep(priv->xclr_settle_us);
+        t = imx377_trace_power(priv, true, IMX377_PHASE_GPIO, t);
+
+        /* Replay everything the sensor lost while unpowered, in bursts */
+        regcache_cache_only(priv->regmap, false);
+        ret = imx377_bcast_sync(priv);
+        if (ret)
+            goto err_cache;
+        imx377_trace_power(priv, true, IMX377_PHASE_REGCACHE, t);
+        imx377_stats_since(priv, IMX377_HIST_POWER_ON, t0);
+        imx377_latency_add(&priv->power_on_lat,
+                           ktime_to_ns(ktime_sub(ktime_get(), t0)));
+        return 0;
+
+    err_cache:
+        regcache_cache_only(priv->regmap, true);
+        if (priv->pwdn_gpio)
+            gpiod_set_value_cansleep(priv->pwdn_gpio, 1);
+        if (priv->reset_gpio)
+            gpiod_set_value_cansleep(priv->reset_gpio, 1);
+        clk_disable_unprepare(priv->xclk);
+    disable_supplies:
+        regulator_bulk_disable(IMX377_NUM_SUPPLIES, priv->supplies);
+        return ret;
+    }
+
+    static void imx377_power_off(struct imx377 *priv)
+    {
+        ktime_t t = trace_imx377_power_enabled() ? ktime_get() : 0;
+
+        imx377_bcast_power_off(priv);
+        priv->paused = false;
+        regcache_cache_only(priv->regmap, true);
+        regcache_mark_dirty(priv->regmap);
+        t = imx377_trace_power(priv, false, IMX377_PHASE_REGCACHE, t);
+
+        if (priv->reset_gpio)
+            gpiod_set_value_cansleep(priv->reset_gpio, 1);
+        if (priv->pwdn_gpio)
+            gpiod_set_value_cansleep(priv->pwdn_gpio, 1);
+        t = imx377_trace_power(priv, false, IMX377_PHASE_GPIO, t);
+
+        clk_disable_unprepare(priv->xclk);
+        t = imx377_trace_power(priv, false, IMX377_PHASE_CLOCK, t);
+
+        regulator_bulk_disable(IMX377_NUM_SUPPLIES, priv->supplies);
+        imx377_trace_power(priv, false, IMX377_PHASE_REGULATORS, t);
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Multi‑sensor synchronisation                                        */
+    /* ------------------------------------------------------------------ */
+
+    /*
+     * Sensors sharing a "sony,sync-group" form one group: a master driving
+     * XVS/XHS and slaves locked to it. Slaves arm (stream on and wait for
+     * sync) in any order; the master's own start is held back until every
+     * slave of its group is armed, so all of them capture the same frame.
+     */
+    static LIST_HEAD(imx377_sync_list);
+    static DEFINE_MUTEX(imx377_sync_lock);
+
+    /* Called with imx377_sync_lock held */
+    static struct imx377 *imx377_sync_master(struct imx377 *priv)
+    {
+        struct imx377 *p;
+
+        list_for_each_entry(p, &imx377_sync_list, sync_node)
+            if (p->sync_group == priv->sync_group &&
+                p->sync_mode == IMX377_SYNC_MASTER)
+                return p;
+        return NULL;
+    }
+
+    /* Called with imx377_sync_lock held */
+    static bool imx377_sync_slaves_armed(struct imx377 *master)
+    {
+        struct imx377 *p;
+
+        list_for_each_entry(p, &imx377_sync_list, sync_node)
+            if (p->sync_group == master->sync_group &&
+                p->sync_mode == IMX377_SYNC_SLAVE && !p->sync_armed)
+                return false;
+        return true;
+    }
+
+    /*
+     * Releases a held master, once its slaves are armed or when it has waited
+     * IMX377_SYNC_TIMEOUT_MS for them. Runs without priv->lock so stop can
+     * cancel it.
+     */
+    static void imx377_sync_work(struct work_struct *work)
+    {
+        struct imx377 *priv = container_of(to_delayed_work(work), struct imx377,
+                                           sync_work);
+        bool timed_out;
+
+        mutex_lock(&imx377_sync_lock);
+        timed_out = priv->sync_pending;
+        priv->sync_pending = false;
+        mutex_unlock(&imx377_sync_lock);
+
+        if (timed_out)
+            dev_warn(&priv->client->dev,
+                     "sync slaves not armed after %u ms, starting unsynchronised\n",
+                     IMX377_SYNC_TIMEOUT_MS);
+
+        if (imx377_write_volatile(priv, IMX377_REG_XMSTA, 0x00))
+            dev_err(&priv->client->dev, "failed to start sync master\n");
+    }
+
+    /* After MODE_SELECT=1: start the master, or record that a slave is armed */
+    static int imx377_sync_start(struct imx377 *priv)
+    {
+        struct imx377 *master;
+        int ret = 0;
+
+        mutex_lock(&imx377_sync_lock);
+        if (priv->sync_mode == IMX377_SYNC_MASTER) {
+            if (imx377_sync_slaves_armed(priv)) {
+                ret = imx377_write_volatile(priv, IMX377_REG_XMSTA, 0x00);
+            } else {
+                priv->sync_pending = true;
+                queue_delayed_work(system_highpri_wq, &priv->sync_work,
+                                   msecs_to_jiffies(IMX377_SYNC_TIMEOUT_MS));
+            }
+        } else {
+            priv->sync_armed = true;
+            master = imx377_sync_master(priv);
+            if (master && master->sync_pending &&
+                imx377_sync_slaves_armed(master)) {
+                master->sync_pending = false;
+                mod_delayed_work(system_highpri_wq, &master->sync_work, 0);
+            }
+        }
+        mutex_unlock(&imx377_sync_lock);
+        return ret;
+    }
+
+    static void imx377_sync_stop(struct imx377 *priv)
+    {
+        mutex_lock(&imx377_sync_lock);
+        priv->sync_armed = false;
+        priv->sync_pending = false;
+        mutex_unlock(&imx377_sync_lock);
+
+        if (priv->sync_mode == IMX377_SYNC_MASTER) {
+            cancel_delayed_work_sync(&priv->sync_work);
+            imx377_write_volatile(priv, IMX377_REG_XMSTA, 0x01);
+        }
+    }
+
+    /*
+     * Slave XVS thread: compare against the master's latest edge. Edges less
+     * than half a frame apart belong to the same frame. The master's
+     * streaming and xvs_ts belong to its own lock and irq; they are only
+     * sampled here, hence READ_ONCE.
+     */
+    static void imx377_sync_update_skew(struct imx377 *priv)
+    {
+        struct imx377 *master;
+        s64 skew, half = priv->frame_ns / 2;
+
+        mutex_lock(&imx377_sync_lock);
+        master = imx377_sync_master(priv);
+        if (master && master->xvs_irq && READ_ONCE(master->streaming) &&
+            priv->frame_ns) {
+            skew = ktime_to_ns(ktime_sub(priv->xvs_ts, READ_ONCE(master->xvs_ts)));
+            while (skew > half)
+                skew -= priv->frame_ns;
+            while (skew < -half)
+                skew += priv->frame_ns;
+
+            priv->sync_skew_ns = skew;
+            if (abs(skew) > priv->sync_skew_max_ns)
+                priv->sync_skew_max_ns = abs(skew);
+        }
+        mutex_unlock(&imx377_sync_lock);
+    }
+
+    static int imx377_sync_parse(struct imx377 *priv)
+    {
+        struct device *dev = &priv->client->dev;
+        const char *mode;
+
+        if (device_property_read_string(dev, "sony,sync-mode", &mode))
+            return 0;
+
+        if (!strcmp(mode, "master"))
+            priv->sync_mode = IMX377_SYNC_MASTER;
+        else if (!strcmp(mode, "slave"))
+            priv->sync_mode = IMX377_SYNC_SLAVE;
+        else
+            return dev_err_probe(dev, -EINVAL, "invalid sony,sync-mode %s\n", mode);
+
+        device_property_read_u32(dev, "sony,sync-group", &priv->sync_group);
+        return 0;
+    }
+
+    static void imx377_sync_register(struct imx377 *priv)
+    {
+        if (priv->sync_mode == IMX377_SYNC_NONE)
+            return;
+
+        mutex_lock(&imx377_sync_lock);
+        list_add_tail(&priv->sync_node, &imx377_sync_list);
+        mutex_unlock(&imx377_sync_lock);
+    }
+
+    static void imx377_sync_unregister(struct imx377 *priv)
+    {
+        if (priv->sync_mode == IMX377_SYNC_NONE)
+            return;
+
+        mutex_lock(&imx377_sync_lock);
+        list_del(&priv->sync_node);
+        mutex_unlock(&imx377_sync_lock);
+        cancel_delayed_work_sync(&priv->sync_work);
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Streaming                                                           */
+    /* ------------------------------------------------------------------ */
+
+    /* Close a stream‑on step begun at *@t, and start the next one */
+    static void imx377_step(struct imx377 *priv, enum imx377_step step, ktime_t *t)
+    {
+        ktime_t now = ktime_get();
+
+        priv->step_ns[step] = ktime_to_ns(ktime_sub(now, *t));
+        *t = now;
+    }
+
+    /* Frame 0 starts now: restart the timeline the control queue runs on */
+    static void imx377_timeline_start(struct imx377 *priv)
+    {
+        priv->frame_ns = imx377_frame_ns(priv->cur_mode, priv->vts);
+        priv->frame_base = ktime_get();
+        priv->frame_base_seq = 0;
+
+        mutex_lock(&priv->queue_lock);
+        priv->queue_len = 0;
+        priv->ticking = true;
+        /* Without XVS, frame starts are estimated */
+        if (!priv->xvs_irq)
+            hrtimer_start(&priv->frame_timer,
+                          ktime_add_ns(priv->frame_base, priv->frame_ns),
+                          HRTIMER_MODE_ABS);
+        mutex_unlock(&priv->queue_lock);
+    }
+
+    /* Triggered: no cadence to run a timeline on, frames come per trigger */
+    static void imx377_trigger_arm(struct imx377 *priv,
+                                   enum v4l2_imx377_trigger_source src)
+    {
+        /* Stream‑on ends here; frame_base is otherwise unused while armed */
+        priv->frame_base = ktime_get();
+
+        mutex_lock(&priv->queue_lock);
+        priv->queue_len = 0;
+        priv->trig_busy = false;
+        priv->trig_armed = src;
+        mutex_unlock(&priv->queue_lock);
+
+        if (src == V4L2_IMX377_TRIGGER_GPIO)
+            enable_irq(priv->trig_irq);
+    }
+
+    /* The frame timer and work are cancelled by imx377_timeline_stop() */
+    static void imx377_trigger_disarm(struct imx377 *priv)
+    {
+        if (priv->trig_armed == V4L2_IMX377_TRIGGER_GPIO)
+            disable_irq(priv->trig_irq);
+
+        mutex_lock(&priv->queue_lock);
+        priv->trig_armed = V4L2_IMX377_TRIGGER_OFF;
+        priv->trig_busy = false;
+        mutex_unlock(&priv->queue_lock);
+    }
+
+    /*
+     * Anything still queued is dropped; the controls already hold the values,
+     * so the caller has to make sure the next start sends them. Returns
+     * whether anything was dropped.
+     */
+    static bool imx377_timeline_stop(struct imx377 *priv)
+    {
+        bool dropped;
+
+        mutex_lock(&priv->queue_lock);
+        priv->ticking = false;
+        dropped = priv->queue_len != 0;
+        priv->queue_len = 0;
+        mutex_unlock(&priv->queue_lock);
+        hrtimer_cancel(&priv->frame_timer);
+        cancel_work_sync(&priv->frame_work);
+        return dropped;
+    }
+
+    static int imx377_start_streaming(struct imx377 *priv)
+    {
+        struct device *dev = &priv->client->dev;
+        enum v4l2_imx377_trigger_source trig = priv->trig_src_ctrl->val;
+        ktime_t t0 = ktime_get(), t;
+        bool cold, switching, resume;
+        int ret;
+
+        /* A triggered sensor has no free‑running XVS to lock a group to */
+        if (trig != V4L2_IMX377_TRIGGER_OFF &&
+            priv->sync_mode != IMX377_SYNC_NONE) {
+            dev_err(dev, "trigger mode cannot be used with sony,sync-mode\n");
+            return -EINVAL;
+        }
+
+        /* Warm starts skip phases; zero them all rather than keep stale ones */
+        memset(priv->step_ns, 0, IMX377_STEP_STREAM_ON * sizeof(u64));
+
+        /* Within the autosuspend window the sensor is still up and programmed */
+        cold = !pm_runtime_active(dev);
+        ret = pm_runtime_resume_and_get(dev);
+        if (ret)
+            return ret;
+        t = ktime_get();
+        imx377_bcast_busy(priv, true);
+
+        switching = priv->applied_mode != priv->cur_mode ||
+                    priv->applied_fmt != priv->cur_fmt;
+
+        /*
+         * Paused and untouched since: mode, window and controls are all
+         * still in the sensor, and MODE_SELECT was left at 1, so leaving
+         * standby is the whole restart; armed for triggers, it stays in
+         * standby and there is nothing to write at all. A new mode or format
+         * set while paused needs its tables, and so does a peer's broadcast;
+         * a sync group has to re‑arm.
+         */
+        resume = priv->paused && !priv->resume_dirty && !switching &&
+                 !READ_ONCE(priv->bcast_touched) &&
+                 priv->sync_mode == IMX377_SYNC_NONE;
+        priv->paused = false;
+        if (resume) {
+            if (priv->xvs_irq) {
+                priv->xvs_seq = 0;
+                enable_irq(priv->xvs_irq);
+            }
+            if (trig == V4L2_IMX377_TRIGGER_OFF)
+                ret = imx377_write_volatile(priv, IMX377_STANDBY, 0x00);
+            if (ret) {
+                if (priv->xvs_irq)
+                    disable_irq(priv->xvs_irq);
+                goto err_power;
+            }
+            imx377_step(priv, IMX377_STEP_MODE_SELECT, &t);
+            goto running;
+        }
+
+        /*
+         * Basic register sequence: standby=0, write mode, then stream=1. For
+         * triggers, standby=1 instead: MODE_SELECT=1 then only arms it.
+         */
+        ret = imx377_write_volatile(priv, IMX377_STANDBY,
+                                    trig == V4L2_IMX377_TRIGGER_OFF ? 0x00 : 0x01);
+        if (ret)
+            goto err_power;
+
+        /* regcache_sync() in power_on has already restored matching tables */
+        ret = priv->bcast ? imx377_bcast_tables(priv) : imx377_apply_tables(priv);
+        if (ret)
+            goto err_power;
+        imx377_step(priv, IMX377_STEP_TABLES, &t);
+
+        ret = imx377_write_window(priv, &priv->crop);
+        if (ret)
+            goto err_power;
+
+        /* A master drives the sync pins but is held until its slaves arm */
+        if (priv->sync_mode != IMX377_SYNC_NONE) {
+            ret = imx377_write_reg(priv, IMX377_REG_SYNCSEL,
+                                   priv->sync_mode == IMX377_SYNC_MASTER ? 0x0A : 0x00);
+            if (!ret && priv->sync_mode == IMX377_SYNC_MASTER)
+                ret = imx377_write_volatile(priv, IMX377_REG_XMSTA, 0x01);
+            if (ret)
+                goto err_power;
+        }
+
+        imx377_step(priv, IMX377_STEP_WINDOW, &t);
+
+        /*
+         * Flush the whole control state (VMAX included) before the first
+         * frame; each cluster goes out as one burst, so the first frame is
+         * already correct.
+         */
+        ret = __v4l2_ctrl_handler_setup(&priv->ctrls);
+        if (ret)
+            goto err_power;
+        imx377_step(priv, IMX377_STEP_CTRL_FLUSH, &t);
+
+        /* Armed before MODE_SELECT so the first XVS is frame 0 */
+        if (priv->xvs_irq) {
+            priv->xvs_seq = 0;
+            enable_irq(priv->xvs_irq);
+        }
+
+        ret = imx377_write_volatile(priv, IMX377_REG_MODE_SELECT, 0x01);
+        if (!ret && priv->sync_mode != IMX377_SYNC_NONE)
+            ret = imx377_sync_start(priv);
+        if (ret) {
+            if (priv->sync_mode != IMX377_SYNC_NONE)
+                imx377_sync_stop(priv);
+            if (priv->xvs_irq)
+                disable_irq(priv->xvs_irq);
+            goto err_power;
+        }
+
+        imx377_step(priv, IMX377_STEP_MODE_SELECT, &t);
+
+    running:
+        if (trig == V4L2_IMX377_TRIGGER_OFF)
+            imx377_timeline_start(priv);
+        else
+            imx377_trigger_arm(priv, trig);
+        WRITE_ONCE(priv->streaming, true);
+        /* The source cannot change under a running or armed sensor */
+        __v4l2_ctrl_grab(priv->trig_src_ctrl, true);
+
+        imx377_latency_add(&priv->stream_on_lat[cold],
+                           ktime_to_ns(ktime_sub(priv->frame_base, t0)));
+        imx377_stats_since(priv, IMX377_HIST_STREAM_ON, t0);
+        priv->step_ns[IMX377_STEP_STREAM_ON] =
+            ktime_to_ns(ktime_sub(priv->frame_base, t0));
+        trace_imx377_stream_on(priv->client,
+                               priv->crop.width / priv->cur_mode->binning,
+                               priv->crop.height / priv->cur_mode->binning,
+                               priv->cur_fmt->code, priv->vts, cold,
+                               ktime_to_ns(ktime_sub(priv->frame_base, t0)), 0);
+        return 0;
+
+    err_power:
+        imx377_bcast_busy(priv, false);
+        pm_runtime_put(dev);
+        trace_imx377_stream_on(priv->client,
+                               priv->crop.width / priv->cur_mode->binning,
+                               priv->crop.height / priv->cur_mode->binning,
+                               priv->cur_fmt->code, priv->vts, cold,
+                               ktime_to_ns(ktime_sub(ktime_get(), t0)), ret);
+        return ret;
+    }
+
+    static int imx377_stop_streaming(struct imx377 *priv)
+    {
+        struct device *dev = &priv->client->dev;
+        ktime_t t0 = ktime_get();
+        bool dropped;
+        int ret;
+
+        if (priv->xvs_irq)
+            disable_irq(priv->xvs_irq);
+        imx377_trigger_disarm(priv);
+        dropped = imx377_timeline_stop(priv);
+
+        if (priv->sync_mode != IMX377_SYNC_NONE)
+            imx377_sync_stop(priv);
+
+        /*
+         * Pausing leaves MODE_SELECT set and only enters standby, which stops
+         * readout but keeps the register file; a sync group stops outright.
+         */
+        if (idle_standby && priv->sync_mode == IMX377_SYNC_NONE) {
+            ret = imx377_write_volatile(priv, IMX377_STANDBY, 0x01);
+            priv->paused = !ret;
+            /* Queued controls never reached the sensor: resume in full */
+            priv->resume_dirty = dropped;
+        } else {
+            ret = imx377_write_volatile(priv, IMX377_REG_MODE_SELECT, 0x00);
+        }
+        WRITE_ONCE(priv->streaming, false);
+        __v4l2_ctrl_grab(priv->trig_src_ctrl, false);
+        imx377_bcast_busy(priv, false);
+        pm_runtime_mark_last_busy(dev);
+        pm_runtime_put_autosuspend(dev);
+        priv->step_ns[IMX377_STEP_STREAM_OFF] = ktime_to_ns(ktime_sub(ktime_get(), t0));
+        trace_imx377_stream_off(priv->client, ret);
+        return ret;
+    }
+
+    static int imx377_runtime_resume(struct device *dev)
+    {
+        struct v4l2_subdev *sd = dev_get_drvdata(dev);
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        return imx377_power_on(priv);
+    }
+
+    static int imx377_runtime_suspend(struct device *dev)
+    {
+        struct v4l2_subdev *sd = dev_get_drvdata(dev);
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        imx377_power_off(priv);
+        return 0;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* V4L2 control operations                                             */
+    /* ------------------------------------------------------------------ */
+
+    static u32 imx377_out_height(struct imx377 *priv)
+    {
+        return priv->crop.height / priv->cur_mode->binning;
+    }
+
+    static void imx377_pack_exp_gain(u8 vals[4], u32 exposure, u32 gain)
+    {
+        vals[0] = (gain >> 8) & 0x07;       /* 11‑bit gain */
+        vals[1] = gain & 0xFF;
+        vals[2] = (exposure >> 8) & 0xFF;   /* 16‑bit coarse integration */
+        vals[3] = exposure & 0xFF;
+    }
+
+    /* Before MODE_SELECT there is no frame to tear: plain bursts, no hold */
+    static int imx377_write_exp_gain(struct imx377 *priv)
+    {
+        u32 vts = imx377_out_height(priv) + priv->vblank_ctrl->val;
+        ktime_t t0 = imx377_stats_time();
+        u8 vals[4];
+        int ret;
+
+        imx377_pack_exp_gain(vals, priv->exp_ctrl->val, priv->gain_ctrl->val);
+
+        ret = imx377_write_vmax(priv, vts);
+        if (!ret)
+            ret = imx377_write_burst(priv, IMX377_REG_GAIN_H, vals, sizeof(vals));
+        if (!ret)
+            priv->vts = vts;
+        imx377_stats_since(priv, IMX377_HIST_CTRL, t0);
+        return ret;
+    }
+
+    /*
+     * Gain (0x3009/0x300A) and exposure (0x300B/0x300C) are adjacent, so a
+     * single burst inside a REGHOLD window latches both on the same frame;
+     * a VMAX change rides in the same window. Called with queue_lock held.
+     */
+    static int imx377_commit_frame_ctrls(struct imx377 *priv,
+                                         const struct imx377_frame_ctrls *c,
+                                         bool set_exp, bool set_gain)
+    {
+        bool new_vts = set_exp && c->vts != priv->vts;
+        ktime_t t0 = imx377_stats_time();
+        u8 vals[4];
+        u64 seq;
+        int ret, err;
+
+        imx377_pack_exp_gain(vals, c->exposure, c->gain);
+        seq = imx377_frame_seq(priv);
+
+        ret = imx377_write_volatile(priv, IMX377_REG_HOLD, 0x01);
+        if (ret)
+            return ret;
+        if (new_vts)
+            ret = imx377_write_vmax(priv, c->vts);
+        if (!ret && set_exp && set_gain)
+            ret = imx377_write_burst(priv, IMX377_REG_GAIN_H, vals, 4);
+        else if (!ret && set_gain)
+            ret = imx377_write_burst(priv, IMX377_REG_GAIN_H, vals, 2);
+        else if (!ret)
+            ret = imx377_write_burst(priv, IMX377_REG_EXPOSURE_H, &vals[2], 2);
+        err = imx377_write_volatile(priv, IMX377_REG_HOLD, 0x00);
+        if (!ret)
+            ret = err;
+
+        priv->ctrl_updates++;
+        if (imx377_frame_seq(priv) != seq)
+            priv->missed_updates++;
+
+        if (!ret && new_vts) {
+            priv->vts = c->vts;
+            imx377_rebase_frames(priv, imx377_frame_ns(priv->cur_mode, c->vts));
+        }
+        imx377_stats_since(priv, IMX377_HIST_CTRL, t0);
+        return ret;
+    }
+
+    /*
+     * While streaming, a control change is tagged with the earliest frame on
+     * which every part of it can show (writes go out at the next frame start
+     * and the slowest register needs IMX377_EXPOSURE_DELAY frames), and each
+     * register is then written exactly its own delay ahead of that frame.
+     */
+    static int imx377_queue_frame_ctrls(struct imx377 *priv)
+    {
+        struct imx377_frame_ctrls *e = NULL;
+        u64 target;
+        int ret = 0;
+
+        mutex_lock(&priv->queue_lock);
+
+        target = imx377_frame_seq(priv) + 1 +
+                 max(IMX377_EXPOSURE_DELAY, IMX377_GAIN_DELAY);
+
+        /* Several changes within one frame coalesce into one entry */
+        if (priv->queue_len) {
+            e = &priv->queue[(priv->queue_head + priv->queue_len - 1) %
+                             IMX377_CTRL_QUEUE_LEN];
+            if (e->target != target || e->exp_sent || e->gain_sent)
+                e = NULL;
+        }
+        if (!e) {
+            if (priv->queue_len == IMX377_CTRL_QUEUE_LEN) {
+                ret = -EBUSY;
+                goto out;
+            }
+            e = &priv->queue[(priv->queue_head + priv->queue_len++) %
+                             IMX377_CTRL_QUEUE_LEN];
+        }
+
+        e->target = target;
+        e->exposure = priv->exp_ctrl->val;
+        e->gain = priv->gain_ctrl->val;
+        e->vts = imx377_out_height(priv) + priv->vblank_ctrl->val;
+        e->exp_sent = false;
+        e->gain_sent = false;
+    out:
+        mutex_unlock(&priv->queue_lock);
+        return ret;
+    }
+
+    /* Frame @seq has just started: send whatever is due. queue_lock held. */
+    static void imx377_frame_tick(struct imx377 *priv, u64 seq)
+    {
+        struct imx377_frame_ctrls c = { };
+        bool set_exp = false, set_gain = false, late = false;
+        unsigned int i;
+
+        for (i = 0; i < priv->queue_len; i++) {
+            struct imx377_frame_ctrls *e =
+                &priv->queue[(priv->queue_head + i) % IMX377_CTRL_QUEUE_LEN];
+
+            if (!e->exp_sent && seq + IMX377_EXPOSURE_DELAY >= e->target) {
+                late |= seq + IMX377_EXPOSURE_DELAY > e->target;
+                c.exposure = e->exposure;
+                c.vts = e->vts;
+                e->exp_sent = set_exp = true;
+            }
+            if (!e->gain_sent && seq + IMX377_GAIN_DELAY >= e->target) {
+                late |= seq + IMX377_GAIN_DELAY > e->target;
+                c.gain = e->gain;
+                e->gain_sent = set_gain = true;
+            }
+        }
+
+        while (priv->queue_len && priv->queue[priv->queue_head].exp_sent &&
+               priv->queue[priv->queue_head].gain_sent) {
+            priv->queue_head = (priv->queue_head + 1) % IMX377_CTRL_QUEUE_LEN;
+            priv->queue_len--;
+        }
+
+        if (!set_exp && !set_gain)
+            return;
+        if (late)
+            priv->missed_updates++;
+        if (imx377_commit_frame_ctrls(priv, &c, set_exp, set_gain))
+            dev_err_ratelimited(&priv->client->dev,
+                                "frame %llu: control commit failed\n", seq);
+    }
+
+    /*
+     * Trigger mode. Between triggers the sensor waits armed in register
+     * standby (MODE_SELECT=1, STANDBY=1), the state a pause leaves it in. A
+     * trigger takes it out of standby and the start of the following frame
+     * puts it back, so each trigger exposes and reads out one frame. That
+     * frame is timed by the driver: the second XVS edge ends it, or without
+     * XVS the frame time estimated from the mode and VMAX.
+     */
+    static int imx377_trigger_fire(struct imx377 *priv,
+                                   enum v4l2_imx377_trigger_source src, ktime_t ts)
+    {
+        int ret;
+
+        mutex_lock(&priv->queue_lock);
+        if (priv->trig_armed != src) {
+            ret = -EBUSY;
+            goto out;
+        }
+        if (priv->trig_busy) {
+            priv->trig_dropped++;
+            ret = -EBUSY;
+            goto out;
+        }
+
+        /* No edges in standby, so the next one is frame 0 */
+        priv->xvs_seq = 0;
+        ret = imx377_write_volatile(priv, IMX377_STANDBY, 0x00);
+        if (ret)
+            goto out;
+        priv->trig_busy = true;
+        priv->trig_ts = ts;
+        priv->trig_count++;
+        imx377_latency_add(&priv->trig_lat, ktime_to_ns(ktime_sub(ktime_get(), ts)));
+        if (!priv->xvs_irq)
+            hrtimer_start(&priv->frame_timer,
+                          ktime_add_ns(ktime_get(),
+                                       imx377_frame_ns(priv->cur_mode, priv->vts)),
+                          HRTIMER_MODE_ABS);
+    out:
+        mutex_unlock(&priv->queue_lock);
+        return ret;
+    }
+
+    /* The triggered frame is out: back to standby. queue_lock held. */
+    static void imx377_trigger_done(struct imx377 *priv)
+    {
+        priv->trig_busy = false;
+        if (imx377_write_volatile(priv, IMX377_STANDBY, 0x01))
+            dev_err_ratelimited(&priv->client->dev,
+                                "trigger: failed to re-enter standby\n");
+    }
+
+    static void imx377_frame_work(struct work_struct *work)
+    {
+        struct imx377 *priv = container_of(work, struct imx377, frame_work);
+        u64 seq;
+
+        mutex_lock(&priv->queue_lock);
+        if (priv->trig_busy)
+            imx377_trigger_done(priv);
+        if (priv->ticking) {
+            seq = imx377_frame_seq(priv);
+            imx377_frame_tick(priv, seq);
+
+            /* Next boundary on the (possibly re‑based) timeline */
+            hrtimer_start(&priv->frame_timer,
+                          ktime_add_ns(priv->frame_base,
+                                       (seq + 1 - priv->frame_base_seq) *
+                                       priv->frame_ns),
+                          HRTIMER_MODE_ABS);
+        }
+        mutex_unlock(&priv->queue_lock);
+    }
+
+    /*
+     * Estimated frame start, or end of a triggered frame; the bus writes
+     * happen in process context.
+     */
+    static enum hrtimer_restart imx377_frame_timer_fn(struct hrtimer *timer)
+    {
+        struct imx377 *priv = container_of(timer, struct imx377, frame_timer);
+
+        queue_work(system_highpri_wq, &priv->frame_work);
+        return HRTIMER_NORESTART;
+    }
+
+    /* Exposure can never run past the frame length */
+    static void imx377_update_exposure_range(struct imx377 *priv)
+    {
+        u32 max = imx377_out_height(priv) + priv->vblank_ctrl->val -
+                  IMX377_EXPOSURE_MARGIN;
+
+        __v4l2_ctrl_modify_range(priv->exp_ctrl, IMX377_EXPOSURE_MIN, max, 1,
+                                 min_t(u32, IMX377_EXPOSURE_DEFAULT, max));
+    }
+
+    static unsigned int imx377_link_freq_index(u64 link_freq)
+    {
+        unsigned int i;
+
+        for (i = 0; i < ARRAY_SIZE(imx377_link_freqs); i++)
+            if (imx377_link_freqs[i] == link_freq)
+                return i;
+        return 0;
+    }
+
+    /*
+     * Re‑derive the timing controls after a mode, format or window change.
+     * VBLANK is reset to the mode's own, i.e. its full frame rate.
+     * Called with priv->lock held.
+     */
+    static void imx377_update_blanking(struct imx377 *priv)
+    {
+        const struct imx377_mode *mode = priv->cur_mode;
+        u32 width = priv->crop.width / mode->binning;
+        u32 height = imx377_out_height(priv);
+        u32 vblank = imx377_crop_vts(mode, &priv->crop) - height;
+        u32 hblank = mode->hts - width;
+        s64 rate = IMX377_PIXEL_RATE;
+
+        __v4l2_ctrl_modify_range(priv->pixel_rate_ctrl, rate, rate, 1, rate);
+        __v4l2_ctrl_s_ctrl(priv->link_freq_ctrl,
+                           imx377_link_freq_index(mode->link_freq));
+        __v4l2_ctrl_modify_range(priv->hblank_ctrl, hblank, hblank, 1, hblank);
+        __v4l2_ctrl_modify_range(priv->vblank_ctrl, vblank,
+                                 IMX377_VTS_MAX - height, 1, vblank);
+        __v4l2_ctrl_s_ctrl(priv->vblank_ctrl, vblank);
+        imx377_update_exposure_range(priv);
+        /* A paused sensor still holds the old window */
+        priv->resume_dirty = true;
+    }
+
+    /* Clamp a new exposure against the new (or unchanged) VBLANK */
+    static int imx377_try_ctrl(struct v4l2_ctrl *ctrl)
+    {
+        struct imx377 *priv = container_of(ctrl->handler, struct imx377, ctrls);
+        u32 max;
+
+        if (ctrl->id == V4L2_CID_EXPOSURE) {
+            max = imx377_out_height(priv) + priv->vblank_ctrl->val -
+                  IMX377_EXPOSURE_MARGIN;
+            priv->exp_ctrl->val = min_t(u32, priv->exp_ctrl->val, max);
+        }
+        return 0;
+    }
+
+    static void imx377_vblank_notify(struct v4l2_ctrl *ctrl, void *arg)
+    {
+        imx377_update_exposure_range(arg);
+    }
+
+    static int imx377_set_ctrl(struct v4l2_ctrl *ctrl)
+    {
+        struct imx377 *priv = container_of(ctrl->handler, struct imx377, ctrls);
+        struct device *dev = &priv->client->dev;
+        int in_use, ret = 0;
+
+        /* A live mode switch writes the whole cluster itself */
+        if (priv->ctrls_held)
+            return 0;
+
+        /* Only an armed, software‑triggered sensor takes a trigger */
+        if (ctrl->id == V4L2_CID_IMX377_SOFTWARE_TRIGGER)
+            return imx377_trigger_fire(priv, V4L2_IMX377_TRIGGER_SOFTWARE,
+                                       ktime_get());
+
+        /*
+         * Unpowered (or paused, which holds no reference): the value is kept
+         * and flushed at the next stream‑on. Without runtime PM (-EINVAL)
+         * the sensor is powered from probe on.
+         */
+        in_use = pm_runtime_get_if_in_use(dev);
+        if (!in_use) {
+            priv->resume_dirty = true;
+            return 0;
+        }
+
+        switch (ctrl->id) {
+        case V4L2_CID_EXPOSURE:
+            /* Cluster master: also carries any gain or VBLANK change */
+            if (!priv->streaming) {
+                ret = imx377_write_exp_gain(priv);
+            } else if (priv->trig_src_ctrl->val == V4L2_IMX377_TRIGGER_OFF) {
+                ret = imx377_queue_frame_ctrls(priv);
+            } else {
+                /*
+                 * Armed for triggers there is no frame cadence to queue
+                 * against: the values go out now, apply from a following
+                 * trigger, and vts changes in step with the trigger timing.
+                 */
+                mutex_lock(&priv->queue_lock);
+                ret = imx377_write_exp_gain(priv);
+                mutex_unlock(&priv->queue_lock);
+            }
+            break;
+        }
+
+        if (in_use > 0)
+            pm_runtime_put(dev);
+        return ret;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* XVS frame‑start interrupt                                           */
+    /* ------------------------------------------------------------------ */
+
+    /*
+     * Timestamp the frame start as close to the edge as possible; the event
+     * is stamped by v4l2_event_queue() right here, in hard IRQ context.
+     */
+    static irqreturn_t imx377_xvs_irq(int irq, void *data)
+    {
+        struct imx377 *priv = data;
+        struct v4l2_event ev = {
+            .type = V4L2_EVENT_FRAME_SYNC,
+        };
+
+        WRITE_ONCE(priv->xvs_ts, ktime_get());
+        priv->xvs_last_seq = priv->xvs_seq++;
+
+        ev.u.frame_sync.frame_sequence = priv->xvs_last_seq;
+        v4l2_event_queue(priv->sd.devnode, &ev);
+
+        return IRQ_WAKE_THREAD;
+    }
+
+    /*
+     * Just after frame start: the safest point to send register updates,
+     * since the whole frame time is left before the next latch.
+     */
+    static irqreturn_t imx377_xvs_thread(int irq, void *data)
+    {
+        struct imx377 *priv = data;
+
+        mutex_lock(&priv->queue_lock);
+        if (priv->ticking) {
+            /* Hardware edges replace the estimated timeline */
+            priv->frame_base = priv->xvs_ts;
+            priv->frame_base_seq = priv->xvs_last_seq;
+            imx377_frame_tick(priv, priv->xvs_last_seq);
+        } else if (priv->trig_busy) {
+            if (!priv->xvs_last_seq)
+                imx377_latency_add(&priv->trig_xvs_lat,
+                                   ktime_to_ns(ktime_sub(priv->xvs_ts,
+                                                         priv->trig_ts)));
+            else
+                imx377_trigger_done(priv);
+        }
+        mutex_unlock(&priv->queue_lock);
+
+        if (priv->sync_mode == IMX377_SYNC_SLAVE)
+            imx377_sync_update_skew(priv);
+
+        return IRQ_HANDLED;
+    }
+
+    /* Trigger input: latency is counted from the edge, not from the thread */
+    static irqreturn_t imx377_trig_irq(int irq, void *data)
+    {
+        struct imx377 *priv = data;
+
+        priv->trig_irq_ts = ktime_get();
+        return IRQ_WAKE_THREAD;
+    }
+
+    static irqreturn_t imx377_trig_thread(int irq, void *data)
+    {
+        struct imx377 *priv = data;
+
+        imx377_trigger_fire(priv, V4L2_IMX377_TRIGGER_GPIO, priv->trig_irq_ts);
+        return IRQ_HANDLED;
+    }
+
+    static const struct v4l2_ctrl_ops imx377_ctrl_ops = {
+        .try_ctrl = imx377_try_ctrl,
+        .s_ctrl = imx377_set_ctrl,
+    };
+
+    static const struct v4l2_ctrl_config imx377_exposure_delay_ctrl = {
+        .ops   = &imx377_ctrl_ops,
+        .id    = V4L2_CID_IMX377_EXPOSURE_DELAY,
+        .name  = "Exposure Delay (frames)",
+        .type  = V4L2_CTRL_TYPE_INTEGER,
+        .flags = V4L2_CTRL_FLAG_READ_ONLY,
+        .min   = IMX377_EXPOSURE_DELAY,
+        .max   = IMX377_EXPOSURE_DELAY,
+        .step  = 1,
+        .def   = IMX377_EXPOSURE_DELAY,
+    };
+
+    static const struct v4l2_ctrl_config imx377_gain_delay_ctrl = {
+        .ops   = &imx377_ctrl_ops,
+        .id    = V4L2_CID_IMX377_GAIN_DELAY,
+        .name  = "Gain Delay (frames)",
+        .type  = V4L2_CTRL_TYPE_INTEGER,
+        .flags = V4L2_CTRL_FLAG_READ_ONLY,
+        .min   = IMX377_GAIN_DELAY,
+        .max   = IMX377_GAIN_DELAY,
+        .step  = 1,
+        .def   = IMX377_GAIN_DELAY,
+    };
+
+    static const char * const imx377_trigger_menu[] = {
+        [V4L2_IMX377_TRIGGER_OFF]       = "Off",
+        [V4L2_IMX377_TRIGGER_GPIO]      = "GPIO",
+        [V4L2_IMX377_TRIGGER_SOFTWARE]  = "Software",
+    };
+
+    static const struct v4l2_ctrl_config imx377_trigger_source_ctrl = {
+        .ops   = &imx377_ctrl_ops,
+        .id    = V4L2_CID_IMX377_TRIGGER_SOURCE,
+        .name  = "Trigger Source",
+        .type  = V4L2_CTRL_TYPE_MENU,
+        .max   = ARRAY_SIZE(imx377_trigger_menu) - 1,
+        .def   = V4L2_IMX377_TRIGGER_OFF,
+        .qmenu = imx377_trigger_menu,
+    };
+
+    static const struct v4l2_ctrl_config imx377_software_trigger_ctrl = {
+        .ops   = &imx377_ctrl_ops,
+        .id    = V4L2_CID_IMX377_SOFTWARE_TRIGGER,
+        .name  = "Software Trigger",
+        .type  = V4L2_CTRL_TYPE_BUTTON,
+    };
+
+    /* ------------------------------------------------------------------ */
+    /* Subdev pad operations                                               */
+    /* ------------------------------------------------------------------ */
+
+    static const struct imx377_format *imx377_find_format(struct imx377 *priv,
+                                                          u32 code)
+    {
+        unsigned int i;
+
+        for (i = 0; i < priv->num_formats; i++)
+            if (priv->formats[i].code == code)
+                return &priv->formats[i];
+
+        return &priv->formats[0];
+    }
+
+    static void imx377_fill_fmt(const struct imx377_mode *mode,
+                                const struct imx377_format *format,
+                                const struct v4l2_rect *crop,
+                                struct v4l2_mbus_framefmt *fmt)
+    {
+        fmt->code   = format->code;
+        fmt->width  = crop->width / mode->binning;
+        fmt->height = crop->height / mode->binning;
+        fmt->field  = V4L2_FIELD_NONE;
+        fmt->colorspace = V4L2_COLORSPACE_RAW;
+    }
+
+    static int imx377_get_fmt(struct v4l2_subdev *sd,
+                              struct v4l2_subdev_state *state,
+                              struct v4l2_subdev_format *fmt)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        if (fmt->which == V4L2_SUBDEV_FORMAT_TRY) {
+            fmt->format = *v4l2_subdev_state_get_format(state, fmt->pad);
+            return 0;
+        }
+
+        mutex_lock(&priv->lock);
+        imx377_fill_fmt(priv->cur_mode, priv->cur_fmt, &priv->crop,
+                        &fmt->format);
+        mutex_unlock(&priv->lock);
+        return 0;
+    }
+
+    /*
+     * Change mode without stopping the stream: hold the sensor in standby
+     * for only as long as it takes to send the mode delta, the format table
+     * if that changed too, the new window and the re‑derived timing, then
+     * let it run again. The registers stay valid throughout, so this costs
+     * a few frame times instead of a full stop and start. On failure the
+     * stream is stopped, and the next start is a full one.
+     * Called with priv->lock held, while streaming.
+     */
+    static int imx377_switch_mode(struct imx377 *priv,
+                                  const struct imx377_mode *mode,
+                                  const struct imx377_format *fmt)
+    {
+        const struct imx377_table *delta = NULL;
+        ktime_t t0 = ktime_get();
+        int ret;
+
+        /* XVS stays armed: with the queue stopped it only counts edges */
+        imx377_timeline_stop(priv);
+
+        ret = imx377_write_volatile(priv, IMX377_STANDBY, 0x01);
+        if (ret)
+            goto err;
+
+        /*
+         * applied_mode is current while streaming, or unknown after a failed
+         * switch; then both tables go out whole.
+         */
+        ret = 0;
+        if (priv->applied_mode != mode) {
+            if (priv->applied_mode)
+                delta = imx377_mode_delta(priv->applied_mode, mode);
+            if (!delta)
+                delta = mode->table;
+            ret = __imx377_write_table(priv, priv->regmap, delta);
+        }
+        if (ret >= 0 && (fmt != priv->applied_fmt || !priv->applied_mode))
+            ret = __imx377_write_table(priv, priv->regmap, fmt->table);
+        priv->applied_mode = NULL;
+        if (ret < 0)
+            goto err;
+        priv->applied_mode = mode;
+        priv->applied_fmt = fmt;
+
+        priv->cur_mode = mode;
+        priv->cur_fmt = fmt;
+        priv->crop = mode->crop;
+        ret = imx377_write_window(priv, &priv->crop);
+        if (ret)
+            goto err;
+
+        /*
+         * Re‑derive the ranges without letting a clamp reach the sensor on
+         * its own, then send VMAX, gain and exposure once, in this burst.
+         */
+        priv->ctrls_held = true;
+        imx377_update_blanking(priv);
+        priv->ctrls_held = false;
+        ret = imx377_write_exp_gain(priv);
+        if (ret)
+            goto err;
+
+        /* No edges in standby, so the next one is frame 0 */
+        priv->xvs_seq = 0;
+        ret = imx377_write_volatile(priv, IMX377_STANDBY, 0x00);
+        if (ret)
+            goto err;
+        imx377_timeline_start(priv);
+
+        priv->step_ns[IMX377_STEP_LIVE_SWITCH] =
+            ktime_to_ns(ktime_sub(priv->frame_base, t0));
+        return 0;
+
+    err:
+        imx377_stop_streaming(priv);
+        priv->paused = false;
+        return ret;
+    }
+
+    static int imx377_set_fmt(struct v4l2_subdev *sd,
+                              struct v4l2_subdev_state *state,
+                              struct v4l2_subdev_format *fmt)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        const struct imx377_format *format;
+        const struct imx377_mode *mode;
+        int ret = 0;
+
+        format = imx377_find_format(priv, fmt->format.code);
+        mode = v4l2_find_nearest_size(priv->modes, priv->num_modes,
+                                      width, height,
+                                      fmt->format.width, fmt->format.height);
+        imx377_fill_fmt(mode, format, &mode->crop, &fmt->format);
+
+        if (fmt->which == V4L2_SUBDEV_FORMAT_TRY) {
+            *v4l2_subdev_state_get_format(state, fmt->pad) = fmt->format;
+            *v4l2_subdev_state_get_crop(state, fmt->pad) = mode->crop;
+            return 0;
+        }
+
+        mutex_lock(&priv->lock);
+        if (!priv->streaming) {
+            /* A new format resets the window to the mode's own */
+            priv->cur_mode = mode;
+            priv->cur_fmt = format;
+            priv->crop = mode->crop;
+            imx377_update_blanking(priv);
+        } else if (mode != priv->cur_mode || format != priv->cur_fmt) {
+            /*
+             * A sync group would lose lock, and an armed sensor has no
+             * frame to switch on, so both have to be restarted
+             */
+            if (priv->sync_mode != IMX377_SYNC_NONE ||
+                priv->trig_src_ctrl->val != V4L2_IMX377_TRIGGER_OFF)
+                ret = -EBUSY;
+            else
+                ret = imx377_switch_mode(priv, mode, format);
+        } else {
+            /* Same mode while streaming: window and timing stay as they are */
+            imx377_fill_fmt(priv->cur_mode, priv->cur_fmt, &priv->crop,
+                            &fmt->format);
+        }
+        mutex_unlock(&priv->lock);
+        return ret;
+    }
+
+    /*
+     * The mode a TRY state was set from: of the modes with its binning (crop
+     * over output width), the one nearest to its output size.
+     */
+    static const struct imx377_mode *
+    imx377_try_mode(struct imx377 *priv, struct v4l2_subdev_state *state,
+                    unsigned int pad)
+    {
+        const struct v4l2_mbus_framefmt *fmt;
+        const struct imx377_mode *best = &priv->modes[0];
+        u32 binning, dist, best_dist = U32_MAX;
+        unsigned int i;
+
+        fmt = v4l2_subdev_state_get_format(state, pad);
+        binning = v4l2_subdev_state_get_crop(state, pad)->width /
+                  max(fmt->width, 1U);
+
+        for (i = 0; i < priv->num_modes; i++) {
+            const struct imx377_mode *mode = &priv->modes[i];
+
+            if (mode->binning != binning)
+                continue;
+            dist = abs((s32)mode->width - (s32)fmt->width) +
+                   abs((s32)mode->height - (s32)fmt->height);
+            if (dist < best_dist) {
+                best = mode;
+                best_dist = dist;
+            }
+        }
+        return best;
+    }
+
+    static int imx377_get_selection(struct v4l2_subdev *sd,
+                                    struct v4l2_subdev_state *state,
+                                    struct v4l2_subdev_selection *sel)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        switch (sel->target) {
+        case V4L2_SEL_TGT_CROP:
+            if (sel->which == V4L2_SUBDEV_FORMAT_TRY) {
+                sel->r = *v4l2_subdev_state_get_crop(state, sel->pad);
+            } else {
+                mutex_lock(&priv->lock);
+                sel->r = priv->crop;
+                mutex_unlock(&priv->lock);
+            }
+            return 0;
+
+        /* The window the mode reads out unless cropped further */
+        case V4L2_SEL_TGT_CROP_DEFAULT:
+            if (sel->which == V4L2_SUBDEV_FORMAT_TRY) {
+                sel->r = imx377_try_mode(priv, state, sel->pad)->crop;
+            } else {
+                mutex_lock(&priv->lock);
+                sel->r = priv->cur_mode->crop;
+                mutex_unlock(&priv->lock);
+            }
+            return 0;
+
+        case V4L2_SEL_TGT_CROP_BOUNDS:
+        case V4L2_SEL_TGT_NATIVE_SIZE:
+            sel->r.left   = 0;
+            sel->r.top    = 0;
+            sel->r.width  = IMX377_NATIVE_WIDTH;
+            sel->r.height = IMX377_NATIVE_HEIGHT;
+            return 0;
+        }
+
+        return -EINVAL;
+    }
+
+    /*
+     * The window is programmed in array pixels. Keep the Bayer phase (even
+     * start) and a width the CSI‑2 receiver and the binner are both happy
+     * with; the output format follows as crop / binning.
+     */
+    static int imx377_set_selection(struct v4l2_subdev *sd,
+                                    struct v4l2_subdev_state *state,
+                                    struct v4l2_subdev_selection *sel)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        const struct imx377_mode *mode;
+        struct v4l2_mbus_framefmt *try_fmt;
+        struct v4l2_rect r;
+        int ret = 0;
+
+        if (sel->target != V4L2_SEL_TGT_CROP)
+            return -EINVAL;
+
+        r.width  = clamp_t(u32, ALIGN_DOWN(sel->r.width, 16),
+                           IMX377_MIN_CROP_WIDTH, IMX377_NATIVE_WIDTH);
+        r.height = clamp_t(u32, ALIGN_DOWN(sel->r.height, 4),
+                           IMX377_MIN_CROP_HEIGHT, IMX377_NATIVE_HEIGHT);
+        r.left   = clamp_t(s32, sel->r.left, 0, IMX377_NATIVE_WIDTH - r.width) & ~1;
+        r.top    = clamp_t(s32, sel->r.top, 0, IMX377_NATIVE_HEIGHT - r.height) & ~1;
+
+        if (sel->which == V4L2_SUBDEV_FORMAT_TRY) {
+            /* Same readout as before, only the window changes */
+            mode = imx377_try_mode(priv, state, sel->pad);
+            try_fmt = v4l2_subdev_state_get_format(state, sel->pad);
+            *v4l2_subdev_state_get_crop(state, sel->pad) = r;
+            imx377_fill_fmt(mode, imx377_find_format(priv, try_fmt->code), &r,
+                            try_fmt);
+            sel->r = r;
+            return 0;
+        }
+
+        mutex_lock(&priv->lock);
+        if (priv->streaming) {
+            ret = -EBUSY;
+        } else {
+            priv->crop = r;
+            imx377_update_blanking(priv);
+            sel->r = r;
+        }
+        mutex_unlock(&priv->lock);
+        return ret;
+    }
+
+    static int imx377_enum_mbus_code(struct v4l2_subdev *sd,
+                                     struct v4l2_subdev_state *state,
+                                     struct v4l2_subdev_mbus_code_enum *code)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        if (code->index >= priv->num_formats)
+            return -EINVAL;
+
+        code->code = priv->formats[code->index].code;
+        return 0;
+    }
+
+    static int imx377_enum_frame_size(struct v4l2_subdev *sd,
+                                      struct v4l2_subdev_state *state,
+                                      struct v4l2_subdev_frame_size_enum *fse)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        const struct imx377_mode *mode;
+
+        if (fse->index >= priv->num_modes)
+            return -EINVAL;
+        if (imx377_find_format(priv, fse->code)->code != fse->code)
+            return -EINVAL;
+
+        mode = &priv->modes[fse->index];
+        fse->min_width  = mode->width;
+        fse->max_width  = mode->width;
+        fse->min_height = mode->height;
+        fse->max_height = mode->height;
+        return 0;
+    }
+
+    /*
+     * One entry per mode producing the requested size: its shortest frame
+     * interval. Anything longer is reachable through set_frame_interval.
+     */
+    static int imx377_enum_frame_interval(struct v4l2_subdev *sd,
+                                          struct v4l2_subdev_state *state,
+                                          struct v4l2_subdev_frame_interval_enum *fie)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        const struct imx377_format *format = imx377_find_format(priv, fie->code);
+        unsigned int i, n = 0;
+
+        if (format->code != fie->code)
+            return -EINVAL;
+
+        for (i = 0; i < priv->num_modes; i++) {
+            const struct imx377_mode *mode = &priv->modes[i];
+
+            if (mode->width != fie->width || mode->height != fie->height)
+                continue;
+            if (n++ == fie->index) {
+                imx377_frame_interval(mode, mode->vts, &fie->interval);
+                return 0;
+            }
+        }
+
+        return -EINVAL;
+    }
+
+    /*
+     * Of the modes producing the same size as @cur, the first (largest
+     * readout) that reaches @fi, or failing that the fastest one.
+     */
+    static const struct imx377_mode *
+    imx377_mode_for_interval(struct imx377 *priv, const struct imx377_mode *cur,
+                             const struct v4l2_fract *fi)
+    {
+        const struct imx377_mode *fastest = cur;
+        u64 want_ns = 0;
+        unsigned int i;
+
+        if (fi->denominator)
+            want_ns = div_u64((u64)fi->numerator * NSEC_PER_SEC, fi->denominator);
 
-    struct imx377_mode {
-        u32 width;
-        u32 height;
-        u32 code;
-        u32 hts;      /* line length in pixels */
-        u32 vts;      /* frame length in lines */
-        u64 link_freq;
-    };
+        for (i = 0; i < priv->num_modes; i++) {
+            const struct imx377_mode *mode = &priv->modes[i];
+            u64 ns;
 
-    static const struct imx377_mode imx377_default_mode = {
-        .width      = 4056,
-        .height     = 3040,
-        .code       = MEDIA_BUS_FMT_SRGGB12_1X12,
-        .hts        = 0x0172,
-        .vts        = 0x0CB2,
-        .link_freq  = IMX377_LINK_FREQ_576MHZ,
-    };
+            if (mode->width != cur->width || mode->height != cur->height)
+                continue;
+            ns = imx377_frame_ns(mode, mode->vts);
+            if (ns <= want_ns)
+                return mode;
+            if (ns < imx377_frame_ns(fastest, fastest->vts))
+                fastest = mode;
+        }
 
-    struct imx377 {
-        struct i2c_client       *client;
-        struct v4l2_subdev       sd;
-        struct media_pad         pad;
+        return fastest;
+    }
 
-        struct clk              *xclk;
-        struct regulator        *avdd;
-        struct regulator        *dvdd;
-        struct regulator        *dovdd;
-        struct gpio_desc        *reset_gpio;
-        struct gpio_desc        *pwdn_gpio;
+    static int imx377_get_frame_interval(struct v4l2_subdev *sd,
+                                         struct v4l2_subdev_state *state,
+                                         struct v4l2_subdev_frame_interval *fi)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
 
-        struct v4l2_ctrl_handler ctrls;
-        struct v4l2_ctrl        *gain_ctrl;
-        struct v4l2_ctrl        *exp_ctrl;
+        if (fi->which == V4L2_SUBDEV_FORMAT_TRY) {
+            fi->interval = *v4l2_subdev_state_get_interval(state, fi->pad);
+            return 0;
+        }
 
-        const struct imx377_mode *cur_mode;
-        struct mutex            lock;   /* protect streaming state */
-        bool                    streaming;
+        mutex_lock(&priv->lock);
+        imx377_frame_interval(priv->cur_mode,
+                              imx377_out_height(priv) + priv->vblank_ctrl->val,
+                              &fi->interval);
+        mutex_unlock(&priv->lock);
+        return 0;
+    }
+
+    static int imx377_set_frame_interval(struct v4l2_subdev *sd,
+                                         struct v4l2_subdev_state *state,
+                                         struct v4l2_subdev_frame_interval *fi)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        const struct imx377_mode *mode;
+        u32 height, vts;
+        int ret;
+
+        if (fi->which == V4L2_SUBDEV_FORMAT_TRY) {
+            mode = imx377_try_mode(priv, state, fi->pad);
+            mode = imx377_mode_for_interval(priv, mode, &fi->interval);
+            vts = imx377_interval_vts(mode, mode->vts, &fi->interval);
+            imx377_frame_interval(mode, vts, &fi->interval);
+            *v4l2_subdev_state_get_interval(state, fi->pad) = fi->interval;
+            return 0;
+        }
+
+        mutex_lock(&priv->lock);
+
+        /* The readout mode can only change while stopped */
+        mode = imx377_mode_for_interval(priv, priv->cur_mode, &fi->interval);
+        if (mode != priv->cur_mode && !priv->streaming) {
+            priv->cur_mode = mode;
+            priv->crop = mode->crop;
+            imx377_update_blanking(priv);
+        }
+
+        height = imx377_out_height(priv);
+        vts = imx377_interval_vts(priv->cur_mode,
+                                  height + priv->vblank_ctrl->minimum,
+                                  &fi->interval);
+        ret = __v4l2_ctrl_s_ctrl(priv->vblank_ctrl, vts - height);
+        imx377_frame_interval(priv->cur_mode, height + priv->vblank_ctrl->val,
+                              &fi->interval);
+
+        mutex_unlock(&priv->lock);
+        return ret;
+    }
+
+    static int imx377_init_state(struct v4l2_subdev *sd,
+                                 struct v4l2_subdev_state *state)
+    {
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        const struct imx377_mode *mode = &priv->modes[0];
+
+        imx377_fill_fmt(mode, &priv->formats[0], &mode->crop,
+                        v4l2_subdev_state_get_format(state, 0));
+        *v4l2_subdev_state_get_crop(state, 0) = mode->crop;
+        imx377_frame_interval(mode, mode->vts,
+                              v4l2_subdev_state_get_interval(state, 0));
+        return 0;
+    }
+
+    static const struct v4l2_subdev_pad_ops imx377_pad_ops = {
+        .get_fmt = imx377_get_fmt,
+        .set_fmt = imx377_set_fmt,
+        .get_selection = imx377_get_selection,
+        .set_selection = imx377_set_selection,
+        .enum_mbus_code = imx377_enum_mbus_code,
+        .enum_frame_size = imx377_enum_frame_size,
+        .enum_frame_interval = imx377_enum_frame_interval,
+        .get_frame_interval = imx377_get_frame_interval,
+        .set_frame_interval = imx377_set_frame_interval,
     };
 
     /* ------------------------------------------------------------------ */
-    /* I2C helpers                                                         */
+    /* Subdev video operations                                             */
     /* ------------------------------------------------------------------ */
 
-    static int imx377_write_reg(struct i2c_client *client, u16 reg, u8 val)
+    static int imx377_s_stream(struct v4l2_subdev *sd, int enable)
     {
-        u8 buf[3] = { reg >> 8, reg & 0xff, val };
-        int ret = i2c_master_send(client, buf, 3);
-        return (ret == 3) ? 0 : (ret < 0 ? ret : -EIO);
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+        int ret = 0;
+
+        mutex_lock(&priv->lock);
+        if (priv->streaming != !!enable)
+            ret = enable ? imx377_start_streaming(priv)
+                         : imx377_stop_streaming(priv);
+        mutex_unlock(&priv->lock);
+        return ret;
     }
 
-    static int imx377_read_reg(struct i2c_client *client, u16 reg, u8 *val)
+    static const struct v4l2_subdev_video_ops imx377_video_ops = {
+        .s_stream = imx377_s_stream,
+    };
+
+    static int imx377_subscribe_event(struct v4l2_subdev *sd, struct v4l2_fh *fh,
+                                      struct v4l2_event_subscription *sub)
     {
-        struct i2c_msg msgs[2] = {
-            { .addr = client->addr, .flags = 0,
-              .buf = (u8[]){ reg >> 8, reg & 0xff }, .len = 2 },
-            { .addr = client->addr, .flags = I2C_M_RD, .buf = val, .len = 1 },
-        };
-        int ret = i2c_transfer(client->adapter, msgs, 2);
-        return (ret == 2) ? 0 : (ret < 0 ? ret : -EIO);
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        switch (sub->type) {
+        case V4L2_EVENT_FRAME_SYNC:
+            return priv->xvs_irq ? v4l2_event_subscribe(fh, sub, 2, NULL) : -EINVAL;
+        case V4L2_EVENT_CTRL:
+            return v4l2_ctrl_subdev_subscribe_event(sd, fh, sub);
+        }
+
+        return -EINVAL;
     }
 
+    static const struct v4l2_subdev_core_ops imx377_core_ops = {
+        .subscribe_event   = imx377_subscribe_event,
+        .unsubscribe_event = v4l2_event_subdev_unsubscribe,
+    };
+
+    static const struct v4l2_subdev_ops imx377_subdev_ops = {
+        .core   = &imx377_core_ops,
+        .pad    = &imx377_pad_ops,
+        .video  = &imx377_video_ops,
+    };
+
+    static const struct v4l2_subdev_internal_ops imx377_internal_ops = {
+        .init_state = imx377_init_state,
+    };
+
     /* ------------------------------------------------------------------ */
-    /* Power management                                                    */
+    /* debugfs                                                             */
     /* ------------------------------------------------------------------ */
 
-    static int imx377_power_on(struct imx377 *priv)
+    static void imx377_latency_show(struct seq_file *m, const char *name,
+                                    const struct imx377_latency *lat)
     {
-        int ret;
+        seq_printf(m, "%s: count %u last %llu min %llu max %llu us\n",
+                   name, lat->count,
+                   div_u64(lat->last_ns, NSEC_PER_USEC),
+                   div_u64(lat->min_ns, NSEC_PER_USEC),
+                   div_u64(lat->max_ns, NSEC_PER_USEC));
+    }
 
-        ret = regulator_enable(priv->dvdd);
-        if (ret) return ret;
-        ret = regulator_enable(priv->avdd);
-        if (ret) goto disable_dvdd;
-        ret = regulator_enable(priv->dovdd);
-        if (ret) goto disable_avdd;
+    static int imx377_stream_latency_show(struct seq_file *m, void *data)
+    {
+        struct imx377 *priv = m->private;
+        static const char * const names[] = { "warm", "cold" };
+        int i;
 
-        ret = clk_prepare_enable(priv->xclk);
-        if (ret) goto disable_dovdd;
+        mutex_lock(&priv->lock);
+        for (i = 0; i < ARRAY_SIZE(priv->stream_on_lat); i++)
+            imx377_latency_show(m, names[i], &priv->stream_on_lat[i]);
+        mutex_unlock(&priv->lock);
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(imx377_stream_latency);
 
-        if (priv->reset_gpio)
-            gpiod_set_value_cansleep(priv->reset_gpio, 1);
-        if (priv->pwdn_gpio)
-            gpiod_set_value_cansleep(priv->pwdn_gpio, 0);
+    /* Rails on to first I2C access done, regcache replay included */
+    static int imx377_power_latency_show(struct seq_file *m, void *data)
+    {
+        struct imx377 *priv = m->private;
 
-        /* Allow time for clocks & regulators to stabilise */
-        usleep_range(5000, 10000);
+        mutex_lock(&priv->lock);
+        imx377_latency_show(m, "power_on", &priv->power_on_lat);
+        mutex_unlock(&priv->lock);
         return 0;
-
-    disable_dovdd:
-        regulator_disable(priv->dovdd);
-    disable_avdd:
-        regulator_disable(priv->avdd);
-    disable_dvdd:
-        regulator_disable(priv->dvdd);
-        return ret;
     }
+    DEFINE_SHOW_ATTRIBUTE(imx377_power_latency);
 
-    static void imx377_power_off(struct imx377 *priv)
+    static int imx377_sync_skew_show(struct seq_file *m, void *data)
     {
-        if (priv->reset_gpio)
-            gpiod_set_value_cansleep(priv->reset_gpio, 0);
-        if (priv->pwdn_gpio)
-            gpiod_set_value_cansleep(priv->pwdn_gpio, 1);
+        struct imx377 *priv = m->private;
 
-        clk_disable_unprepare(priv->xclk);
-        regulator_disable(priv->dovdd);
-        regulator_disable(priv->avdd);
-        regulator_disable(priv->dvdd);
+        mutex_lock(&imx377_sync_lock);
+        seq_printf(m, "last %lld ns max %lld ns\n",
+                   priv->sync_skew_ns, priv->sync_skew_max_ns);
+        mutex_unlock(&imx377_sync_lock);
+        return 0;
     }
+    DEFINE_SHOW_ATTRIBUTE(imx377_sync_skew);
 
-    /* ------------------------------------------------------------------ */
-    /* Streaming                                                           */
-    /* ------------------------------------------------------------------ */
+    static int imx377_trigger_show(struct seq_file *m, void *data)
+    {
+        struct imx377 *priv = m->private;
 
-    static int imx377_start_streaming(struct imx377 *priv)
+        mutex_lock(&priv->queue_lock);
+        seq_printf(m, "triggers %u dropped %u\n", priv->trig_count,
+                   priv->trig_dropped);
+        imx377_latency_show(m, "standby_exit", &priv->trig_lat);
+        /* Needs XVS */
+        if (priv->xvs_irq)
+            imx377_latency_show(m, "frame_start", &priv->trig_xvs_lat);
+        mutex_unlock(&priv->queue_lock);
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(imx377_trigger);
+
+    static int imx377_broadcast_show(struct seq_file *m, void *data)
     {
-        int ret;
+        struct imx377 *priv = m->private;
 
-        ret = imx377_power_on(priv);
-        if (ret)
-            return ret;
+        mutex_lock(&priv->bcast->lock);
+        seq_printf(m, "sent %u received %u saved %u transactions\n",
+                   priv->bcast_sent, priv->bcast_received, priv->bcast_saved);
+        mutex_unlock(&priv->bcast->lock);
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(imx377_broadcast);
 
-        /* Basic register sequence: standby=0, write mode, then stream=1 */
-        ret = imx377_write_reg(priv->client, IMX377_STANDBY, 0x00);
-        if (ret)
-            goto err_power;
+    /* Modes in use, where they came from, and their table cost */
+    static int imx377_modes_show(struct seq_file *m, void *data)
+    {
+        struct imx377 *priv = m->private;
+        unsigned int i;
 
-        /* TODO: mode register table based on priv->cur_mode */
+        seq_printf(m, "source %s\n",
+                   priv->fw_modes ? priv->fw_modes->name : "built-in");
+        for (i = 0; i < priv->num_modes; i++) {
+            const struct imx377_mode *mode = &priv->modes[i];
 
-        ret = imx377_write_reg(priv->client, IMX377_REG_MODE_SELECT, 0x01);
-        if (ret)
-            goto err_power;
+            seq_printf(m, "mode %ux%u hts %u vts %u link %llu regs %u bursts %u\n",
+                       mode->width, mode->height, mode->hts, mode->vts,
+                       mode->link_freq, mode->table->regs, mode->table->bursts);
+        }
+        for (i = 0; i < priv->num_formats; i++) {
+            const struct imx377_format *fmt = &priv->formats[i];
 
-        priv->streaming = true;
+            seq_printf(m, "format 0x%04x bpp %u regs %u bursts %u\n",
+                       fmt->code, fmt->bpp, fmt->table->regs,
+                       fmt->table->bursts);
+        }
         return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(imx377_modes);
 
-    err_power:
-        imx377_power_off(priv);
-        return ret;
+    static int imx377_steps_show(struct seq_file *m, void *data)
+    {
+        static const char * const names[] = {
+            "regulators", "xclk", "reset_release", "settle", "regcache_sync",
+            "tables", "window", "ctrl_flush", "mode_select", "stream_on",
+            "stream_off", "live_switch", "probe",
+        };
+        struct imx377 *priv = m->private;
+        int i;
+
+        BUILD_BUG_ON(ARRAY_SIZE(names) != IMX377_STEP_NR);
+
+        mutex_lock(&priv->lock);
+        for (i = 0; i < IMX377_STEP_NR; i++)
+            seq_printf(m, "%s %llu\n", names[i], priv->step_ns[i]);
+        mutex_unlock(&priv->lock);
+        return 0;
     }
+    DEFINE_SHOW_ATTRIBUTE(imx377_steps);
 
-    static int imx377_stop_streaming(struct imx377 *priv)
+    #ifdef CONFIG_VIDEO_IMX377_BENCH
+    /*
+     * Benchmark hook: start or stop the sensor as a bridge would, so stream
+     * cycles can be timed with no receiver, e.g. against imx377-emu. Once
+     * the subdev is bound to a v4l2_device the receiver owns the stream and
+     * this is refused.
+     */
+    static ssize_t imx377_stream_write(struct file *file, const char __user *buf,
+                                       size_t count, loff_t *ppos)
     {
-        int ret = imx377_write_reg(priv->client, IMX377_REG_MODE_SELECT, 0x00);
-        priv->streaming = false;
-        imx377_power_off(priv);
-        return ret;
+        struct imx377 *priv = file->private_data;
+        bool enable;
+        int ret;
+
+        ret = kstrtobool_from_user(buf, count, &enable);
+        if (ret)
+            return ret;
+        if (priv->sd.v4l2_dev)
+            return -EBUSY;
+
+        ret = imx377_s_stream(&priv->sd, enable);
+        return ret ? ret : count;
     }
 
-    /* ------------------------------------------------------------------ */
-    /* V4L2 control operations                                             */
-    /* ------------------------------------------------------------------ */
+    static const struct file_operations imx377_stream_fops = {
+        .owner  = THIS_MODULE,
+        .open   = simple_open,
+        .write  = imx377_stream_write,
+        .llseek = noop_llseek,
+    };
 
-    static int imx377_set_ctrl(struct v4l2_ctrl *ctrl)
+    static void imx377_bench_debugfs_init(struct imx377 *priv)
     {
-        struct imx377 *priv = container_of(ctrl->handler, struct imx377, ctrls);
-        struct i2c_client *client = priv->client;
-        int ret = 0;
+        debugfs_create_file("stream", 0200, priv->debugfs, priv,
+                            &imx377_stream_fops);
+    }
+    #else
+    static inline void imx377_bench_debugfs_init(struct imx377 *priv)
+    {
+    }
+    #endif
 
-        if (!priv->streaming)
-            return 0; /* defer until streaming */
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+    static void imx377_stats_sum(struct imx377 *priv, struct imx377_stats *sum)
+    {
+        unsigned int cpu, i, h, b;
 
-        switch (ctrl->id) {
-        case V4L2_CID_EXPOSURE:
-            /* 16‑bit coarse integration time register */
-            ret  = imx377_write_reg(client, IMX377_REG_EXPOSURE_H, (ctrl->val >> 8) & 0xFF);
-            ret |= imx377_write_reg(client, IMX377_REG_EXPOSURE_L, ctrl->val & 0xFF);
-            break;
+        memset(sum, 0, sizeof(*sum));
+        for_each_possible_cpu(cpu) {
+            const struct imx377_stats *st = per_cpu_ptr(priv->stats, cpu);
 
-        case V4L2_CID_ANALOGUE_GAIN:
-            /* 11‑bit gain; split across two regs */
-            ret  = imx377_write_reg(client, IMX377_REG_GAIN_H, (ctrl->val >> 8) & 0x07);
-            ret |= imx377_write_reg(client, IMX377_REG_GAIN_L, ctrl->val & 0xFF);
-            break;
+            for (i = 0; i < IMX377_IO_NR; i++) {
+                sum->xfers[i] += st->xfers[i];
+                sum->bytes[i] += st->bytes[i];
+                sum->errors[i] += st->errors[i];
+            }
+            for (h = 0; h < IMX377_HIST_NR; h++)
+                for (b = 0; b < IMX377_HIST_BUCKETS; b++)
+                    sum->hist[h][b] += st->hist[h][b];
         }
-        return ret;
     }
 
-    static const struct v4l2_ctrl_ops imx377_ctrl_ops = {
-        .s_ctrl = imx377_set_ctrl,
-    };
+    static int imx377_io_show(struct seq_file *m, void *data)
+    {
+        static const char * const names[] = { "read", "write" };
+        struct imx377 *priv = m->private;
+        struct imx377_stats *sum;
+        unsigned int i;
 
-    /* ------------------------------------------------------------------ */
-    /* Subdev pad operations                                               */
-    /* ------------------------------------------------------------------ */
+        sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+        if (!sum)
+            return -ENOMEM;
+        imx377_stats_sum(priv, sum);
 
-    static int imx377_get_fmt(struct v4l2_subdev *sd,
-                              struct v4l2_subdev_pad_config *cfg,
-                              struct v4l2_subdev_format *fmt)
+        for (i = 0; i < IMX377_IO_NR; i++)
+            seq_printf(m, "%s: transactions %llu bytes %llu errors %llu\n",
+                       names[i], sum->xfers[i], sum->bytes[i], sum->errors[i]);
+        kfree(sum);
+        return 0;
+    }
+    DEFINE_SHOW_ATTRIBUTE(imx377_io);
+
+    static int imx377_histograms_show(struct seq_file *m, void *data)
     {
-        struct imx377 *priv = container_of(sd, struct imx377, sd);
-        const struct imx377_mode *mode = priv->cur_mode;
+        static const char * const names[] = {
+            "register_write", "ctrl_update", "power_on", "stream_on",
+        };
+        struct imx377 *priv = m->private;
+        struct imx377_stats *sum;
+        unsigned int h, b;
+
+        sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+        if (!sum)
+            return -ENOMEM;
+        imx377_stats_sum(priv, sum);
 
-        fmt->format.code   = mode->code;
-        fmt->format.width  = mode->width;
-        fmt->format.height = mode->height;
-        fmt->format.field  = V4L2_FIELD_NONE;
-        fmt->format.colorspace = V4L2_COLORSPACE_RAW;
+        for (h = 0; h < IMX377_HIST_NR; h++) {
+            seq_printf(m, "%s:\n", names[h]);
+            for (b = 0; b < IMX377_HIST_BUCKETS; b++)
+                if (sum->hist[h][b])
+                    seq_printf(m, "  >= %10llu ns: %u\n", 1ULL << b,
+                               sum->hist[h][b]);
+        }
+        kfree(sum);
         return 0;
     }
+    DEFINE_SHOW_ATTRIBUTE(imx377_histograms);
 
-    static int imx377_set_fmt(struct v4l2_subdev *sd,
-                              struct v4l2_subdev_pad_config *cfg,
-                              struct v4l2_subdev_format *fmt)
+    /* Any write clears every counter and histogram */
+    static ssize_t imx377_stats_reset_write(struct file *file,
+                                            const char __user *buf,
+                                            size_t count, loff_t *ppos)
     {
-        struct imx377 *priv = container_of(sd, struct imx377, sd);
-        /* Only one fixed mode for now */
-        priv->cur_mode = &imx377_default_mode;
-        return imx377_get_fmt(sd, cfg, fmt);
+        struct imx377 *priv = file->private_data;
+        unsigned int cpu;
+
+        for_each_possible_cpu(cpu)
+            memset(per_cpu_ptr(priv->stats, cpu), 0, sizeof(struct imx377_stats));
+        return count;
     }
 
-    static const struct v4l2_subdev_pad_ops imx377_pad_ops = {
-        .get_fmt = imx377_get_fmt,
-        .set_fmt = imx377_set_fmt,
-        .enum_mbus_code = NULL, /* simple fixed format driver */
+    static const struct file_operations imx377_stats_reset_fops = {
+        .owner  = THIS_MODULE,
+        .open   = simple_open,
+        .write  = imx377_stats_reset_write,
+        .llseek = noop_llseek,
     };
 
-    static const struct v4l2_subdev_video_ops imx377_video_ops = {
-        .s_stream = NULL, /* filled later */
-    };
+    static void imx377_stats_debugfs_init(struct imx377 *priv)
+    {
+        struct dentry *dir = debugfs_create_dir("stats", priv->debugfs);
 
-    static const struct v4l2_subdev_ops imx377_subdev_ops = {
-        .pad    = &imx377_pad_ops,
-        .video  = &imx377_video_ops,
-    };
+        debugfs_create_file("io", 0444, dir, priv, &imx377_io_fops);
+        debugfs_create_file("histograms", 0444, dir, priv,
+                            &imx377_histograms_fops);
+        debugfs_create_file("reset", 0200, dir, priv, &imx377_stats_reset_fops);
+    }
+    #else
+    static inline void imx377_stats_debugfs_init(struct imx377 *priv)
+    {
+    }
+    #endif
+
+    static void imx377_debugfs_init(struct imx377 *priv)
+    {
+        char name[32];
+
+        snprintf(name, sizeof(name), "imx377-%s", dev_name(&priv->client->dev));
+        priv->debugfs = debugfs_create_dir(name, NULL);
+
+        debugfs_create_u32("ctrl_updates", 0444, priv->debugfs,
+                           &priv->ctrl_updates);
+        debugfs_create_u32("missed_frame_updates", 0444, priv->debugfs,
+                           &priv->missed_updates);
+        debugfs_create_file("stream_on_latency", 0444, priv->debugfs, priv,
+                            &imx377_stream_latency_fops);
+        debugfs_create_file("power_on_latency", 0444, priv->debugfs, priv,
+                            &imx377_power_latency_fops);
+        /* Needs XVS on both this slave and its master */
+        if (priv->sync_mode == IMX377_SYNC_SLAVE)
+            debugfs_create_file("sync_skew", 0444, priv->debugfs, priv,
+                                &imx377_sync_skew_fops);
+        debugfs_create_file("modes", 0444, priv->debugfs, priv,
+                            &imx377_modes_fops);
+        /* Triggers taken and dropped, trigger to standby exit / frame start */
+        debugfs_create_file("trigger", 0444, priv->debugfs, priv,
+                            &imx377_trigger_fops);
+        /* Table transactions broadcast, and those peers' broadcasts saved */
+        if (priv->bcast)
+            debugfs_create_file("broadcast", 0444, priv->debugfs, priv,
+                                &imx377_broadcast_fops);
+        /* ns per step of the last probe and stream cycle */
+        debugfs_create_file("steps", 0444, priv->debugfs, priv,
+                            &imx377_steps_fops);
+        imx377_stats_debugfs_init(priv);
+        imx377_bench_debugfs_init(priv);
+    }
 
     /* ------------------------------------------------------------------ */
     /* Probe / Remove                                                      */
     /* ------------------------------------------------------------------ */
 
+    /* V4L2 ctrl handler, with the timing ranges of the current mode */
+    static int imx377_init_controls(struct imx377 *priv)
+    {
+        struct v4l2_ctrl_config trig_src = imx377_trigger_source_ctrl;
+
+        v4l2_ctrl_handler_init(&priv->ctrls, 10);
+        priv->ctrls.lock = &priv->lock;  /* s_stream flushes under the same lock */
+        priv->gain_ctrl = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
+                                            V4L2_CID_ANALOGUE_GAIN, 0, 0x7A5, 1, 0);
+        priv->exp_ctrl  = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
+                                            V4L2_CID_EXPOSURE, IMX377_EXPOSURE_MIN,
+                                            IMX377_VTS_MAX - IMX377_EXPOSURE_MARGIN,
+                                            1, IMX377_EXPOSURE_DEFAULT);
+        priv->vblank_ctrl = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
+                                              V4L2_CID_VBLANK, 0,
+                                              IMX377_VTS_MAX, 1, 0);
+        priv->hblank_ctrl = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
+                                              V4L2_CID_HBLANK, 0, 0xFFFF, 1, 0);
+        priv->pixel_rate_ctrl = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
+                                                  V4L2_CID_PIXEL_RATE, 1,
+                                                  INT_MAX, 1, 1);
+        priv->link_freq_ctrl = v4l2_ctrl_new_int_menu(&priv->ctrls, &imx377_ctrl_ops,
+                                                      V4L2_CID_LINK_FREQ,
+                                                      ARRAY_SIZE(imx377_link_freqs) - 1,
+                                                      0, imx377_link_freqs);
+        v4l2_ctrl_new_custom(&priv->ctrls, &imx377_exposure_delay_ctrl, NULL);
+        v4l2_ctrl_new_custom(&priv->ctrls, &imx377_gain_delay_ctrl, NULL);
+        /* GPIO is only offered with a trigger input wired up */
+        if (!priv->trig_irq)
+            trig_src.menu_skip_mask = BIT(V4L2_IMX377_TRIGGER_GPIO);
+        priv->trig_src_ctrl = v4l2_ctrl_new_custom(&priv->ctrls, &trig_src, NULL);
+        v4l2_ctrl_new_custom(&priv->ctrls, &imx377_software_trigger_ctrl, NULL);
+        priv->sd.ctrl_handler = &priv->ctrls;
+        if (priv->ctrls.error) {
+            int ret = priv->ctrls.error;
+
+            v4l2_ctrl_handler_free(&priv->ctrls);
+            return ret;
+        }
+
+        priv->hblank_ctrl->flags |= V4L2_CTRL_FLAG_READ_ONLY;
+        priv->pixel_rate_ctrl->flags |= V4L2_CTRL_FLAG_READ_ONLY;
+        priv->link_freq_ctrl->flags |= V4L2_CTRL_FLAG_READ_ONLY;
+        v4l2_ctrl_cluster(3, &priv->exp_ctrl);
+        v4l2_ctrl_notify(priv->vblank_ctrl, imx377_vblank_notify, priv);
+
+        mutex_lock(&priv->lock);
+        imx377_update_blanking(priv);
+        mutex_unlock(&priv->lock);
+        return 0;
+    }
+
     static int imx377_probe(struct i2c_client *client)
     {
         struct device *dev = &client->dev;
+        ktime_t t0 = ktime_get();
         struct imx377 *priv;
+        unsigned int i;
         int ret;
 
         priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
@@ -281,62 +3290,193 @@
 
         priv->client = client;
         mutex_init(&priv->lock);
-        priv->cur_mode = &imx377_default_mode;
+        mutex_init(&priv->queue_lock);
+        INIT_WORK(&priv->frame_work, imx377_frame_work);
+        INIT_DELAYED_WORK(&priv->sync_work, imx377_sync_work);
+        hrtimer_setup(&priv->frame_timer, imx377_frame_timer_fn, CLOCK_MONOTONIC,
+                      HRTIMER_MODE_ABS);
+        priv->regmap = devm_regmap_init_i2c(client, &imx377_regmap_config);
+        if (IS_ERR(priv->regmap))
+            return PTR_ERR(priv->regmap);
+        /* Sensor is unpowered until power‑on at the end of probe */
+        regcache_cache_only(priv->regmap, true);
+
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+        priv->stats = devm_alloc_percpu(dev, struct imx377_stats);
+        if (!priv->stats)
+            return -ENOMEM;
+    #endif
+
+        /* The first mode and format of the set in use are the defaults */
+        ret = imx377_fw_modes_get(priv);
+        if (ret)
+            return ret;
+        priv->cur_mode = priv->fw_modes ? &priv->modes[0] : imx377_default_mode;
+        priv->cur_fmt = &priv->formats[0];
+        priv->crop = priv->cur_mode->crop;
+
+        ret = imx377_sync_parse(priv);
+        if (ret)
+            return ret;
 
         /* Regulators */
-        priv->avdd  = devm_regulator_get(dev, "avdd");
-        priv->dvdd  = devm_regulator_get(dev, "dvdd");
-        priv->dovdd = devm_regulator_get(dev, "dovdd");
-        if (IS_ERR(priv->avdd) || IS_ERR(priv->dvdd) || IS_ERR(priv->dovdd))
-            return -EPROBE_DEFER;
+        for (i = 0; i < IMX377_NUM_SUPPLIES; i++)
+            priv->supplies[i].supply = imx377_supply_names[i];
+        ret = devm_regulator_bulk_get(dev, IMX377_NUM_SUPPLIES, priv->supplies);
+        if (ret)
+            return dev_err_probe(dev, ret, "failed to get supplies\n");
+
+        /* Power‑up timing: driver defaults unless the board needs more */
+        priv->rail_settle_us = IMX377_RAIL_SETTLE_US;
+        priv->inck_settle_us = IMX377_INCK_SETTLE_US;
+        priv->xclr_settle_us = IMX377_XCLR_SETTLE_US;
+        device_property_read_u32(dev, "sony,rail-settle-us", &priv->rail_settle_us);
+        device_property_read_u32(dev, "sony,inck-settle-us", &priv->inck_settle_us);
+        device_property_read_u32(dev, "sony,xclr-settle-us", &priv->xclr_settle_us);
 
         /* Clock */
         priv->xclk = devm_clk_get(dev, "xclk");
         if (IS_ERR(priv->xclk))
             return -EPROBE_DEFER;
-        clk_set_rate(priv->xclk, 24000000);
+        clk_set_rate(priv->xclk, IMX377_INCK_FREQ);
 
-        /* GPIOs */
-        priv->reset_gpio = devm_gpiod_get_optional(dev, "reset", GPIOD_OUT_LOW);
+        /* GPIOs; XCLR is held asserted until power‑on releases it */
+        priv->reset_gpio = devm_gpiod_get_optional(dev, "reset", GPIOD_OUT_HIGH);
         priv->pwdn_gpio  = devm_gpiod_get_optional(dev, "pwdn",  GPIOD_OUT_HIGH);
 
-        /* V4L2 ctrl handler */
-        v4l2_ctrl_handler_init(&priv->ctrls, 2);
-        priv->gain_ctrl = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
-                                            V4L2_CID_ANALOGUE_GAIN, 0, 0x7A5, 1, 0);
-        priv->exp_ctrl  = v4l2_ctrl_new_std(&priv->ctrls, &imx377_ctrl_ops,
-                                            V4L2_CID_EXPOSURE, 1, 0xFFFF, 1, 0x03E8);
-        priv->sd.ctrl_handler = &priv->ctrls;
-        if (priv->ctrls.error)
-            return priv->ctrls.error;
+        /* Optional XVS: hardware frame starts and FRAME_SYNC events */
+        priv->xvs_gpio = devm_gpiod_get_optional(dev, "xvs", GPIOD_IN);
+        if (IS_ERR(priv->xvs_gpio))
+            return PTR_ERR(priv->xvs_gpio);
+        if (priv->xvs_gpio) {
+            priv->xvs_irq = gpiod_to_irq(priv->xvs_gpio);
+            if (priv->xvs_irq < 0)
+                return priv->xvs_irq;
+            /* XVS is an active‑low pulse at each frame start */
+            ret = devm_request_threaded_irq(dev, priv->xvs_irq, imx377_xvs_irq,
+                                            imx377_xvs_thread,
+                                            IRQF_TRIGGER_FALLING | IRQF_ONESHOT |
+                                            IRQF_NO_AUTOEN,
+                                            "imx377-xvs", priv);
+            if (ret)
+                return ret;
+        }
+
+        /* Optional trigger input: one frame per rising edge in GPIO mode */
+        priv->trig_gpio = devm_gpiod_get_optional(dev, "trigger", GPIOD_IN);
+        if (IS_ERR(priv->trig_gpio))
+            return PTR_ERR(priv->trig_gpio);
+        if (priv->trig_gpio) {
+            priv->trig_irq = gpiod_to_irq(priv->trig_gpio);
+            if (priv->trig_irq < 0)
+                return priv->trig_irq;
+            ret = devm_request_threaded_irq(dev, priv->trig_irq, imx377_trig_irq,
+                                            imx377_trig_thread,
+                                            IRQF_TRIGGER_RISING | IRQF_ONESHOT |
+                                            IRQF_NO_AUTOEN,
+                                            "imx377-trigger", priv);
+            if (ret)
+                return ret;
+        }
+
+        /* Still unpowered: this only fills the control values and regcache */
+        ret = imx377_init_controls(priv);
+        if (ret)
+            return ret;
 
         /* Subdev */
         v4l2_i2c_subdev_init(&priv->sd, client, &imx377_subdev_ops);
-        priv->sd.flags |= V4L2_SUBDEV_FL_HAS_DEVNODE;
+        priv->sd.internal_ops = &imx377_internal_ops;
+        priv->sd.flags |= V4L2_SUBDEV_FL_HAS_DEVNODE | V4L2_SUBDEV_FL_HAS_EVENTS;
 
         /* Pad */
         priv->pad.flags = MEDIA_PAD_FL_SOURCE;
         ret = media_entity_pads_init(&priv->sd.entity, 1, &priv->pad);
         if (ret)
-            return ret;
+            goto err_ctrls;
         priv->sd.entity.function = MEDIA_ENT_F_CAM_SENSOR;
 
+        /* Before power‑on, so the coordinator sees this sensor powered */
+        ret = imx377_bcast_get(priv);
+        if (ret)
+            goto err_entity;
+
+        /*
+         * Power up here and let runtime PM take it down once idle, so the
+         * sensor also works with CONFIG_PM=n; the control values set above
+         * sit in the regcache and go out with its replay.
+         */
+        ret = imx377_power_on(priv);
+        if (ret) {
+            dev_err_probe(dev, ret, "failed to power on\n");
+            goto err_bcast;
+        }
+
+        pm_runtime_set_active(dev);
+        pm_runtime_get_noresume(dev);
+        pm_runtime_enable(dev);
+        pm_runtime_set_autosuspend_delay(dev, autosuspend_ms);
+        pm_runtime_use_autosuspend(dev);
+
+        imx377_sync_register(priv);
+
         /* Register subdev */
         ret = v4l2_async_register_subdev(&priv->sd);
-        if (ret)
-            return ret;
+        if (ret) {
+            imx377_sync_unregister(priv);
+            goto err_pm;
+        }
+
+        pm_runtime_mark_last_busy(dev);
+        pm_runtime_put_autosuspend(dev);
+
+        priv->step_ns[IMX377_STEP_PROBE] = ktime_to_ns(ktime_sub(ktime_get(), t0));
+        imx377_debugfs_init(priv);
 
-        dev_info(dev, "IMX377 sensor probed
-");
+        dev_info(dev, "IMX377 sensor probed\n");
         return 0;
+
+    err_pm:
+        pm_runtime_disable(dev);
+        pm_runtime_set_suspended(dev);
+        pm_runtime_put_noidle(dev);
+        pm_runtime_dont_use_autosuspend(dev);
+        imx377_power_off(priv);
+    err_bcast:
+        imx377_bcast_put(priv);
+    err_entity:
+        media_entity_cleanup(&priv->sd.entity);
+    err_ctrls:
+        v4l2_ctrl_handler_free(&priv->ctrls);
+        return ret;
     }
 
     static void imx377_remove(struct i2c_client *client)
     {
-        struct imx377 *priv = i2c_get_clientdata(client);
+        struct v4l2_subdev *sd = i2c_get_clientdata(client);
+        struct imx377 *priv = container_of(sd, struct imx377, sd);
+
+        debugfs_remove_recursive(priv->debugfs);
+        /* A stream started from the bench file has no bridge to stop it */
+        if (IS_ENABLED(CONFIG_VIDEO_IMX377_BENCH))
+            imx377_s_stream(&priv->sd, 0);
         v4l2_async_unregister_subdev(&priv->sd);
+        imx377_sync_unregister(priv);
         media_entity_cleanup(&priv->sd.entity);
+
+        /* Nothing may tick into the controls once they are freed */
+        if (priv->xvs_irq)
+            disable_irq(priv->xvs_irq);
+        imx377_trigger_disarm(priv);
+        imx377_timeline_stop(priv);
         v4l2_ctrl_handler_free(&priv->ctrls);
+
+        pm_runtime_disable(&client->dev);
+        if (!pm_runtime_status_suspended(&client->dev))
+            imx377_power_off(priv);
+        pm_runtime_set_suspended(&client->dev);
+        pm_runtime_dont_use_autosuspend(&client->dev);
+        imx377_bcast_put(priv);
     }
 
     /* I2C boilerplate */
@@ -346,15 +3486,25 @@
     };
     MODULE_DEVICE_TABLE(of, imx377_of_table);
 
+    static const struct dev_pm_ops imx377_pm_ops = {
+        SET_RUNTIME_PM_OPS(imx377_runtime_suspend, imx377_runtime_resume, NULL)
+    };
+
     static struct i2c_driver imx377_driver = {
         .driver = {
             .name  = "imx377",
             .of_match_table = imx377_of_table,
+            .pm    = &imx377_pm_ops,
         },
-        .probe_new = imx377_probe,
-        .remove    = imx377_remove,
+        .probe  = imx377_probe,
+        .remove = imx377_remove,
     };
     module_i2c_driver(imx377_driver);
 
+    MODULE_FIRMWARE(IMX377_FW_NAME);
     MODULE_DESCRIPTION("Sony IMX377 image sensor driver (reference)");
     MODULE_LICENSE("GPL v2");
+
+    #ifdef CONFIG_VIDEO_IMX377_KUNIT_TEST
+    #include "imx377_test.c"
+    #endif
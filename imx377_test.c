@@ -0,0 +1,484 @@
+    /* SPDX-License-Identifier: GPL-2.0 */
+    /*
+     * KUnit tests for the IMX377 driver: the exact bytes it puts on the bus
+     * for stream‑on, pause/resume, a live mode switch, a per‑frame control
+     * update and a software trigger.
+     *
+     * The sensor is a fake I2C adapter holding the register file. Every
+     * write message is logged and compared against the expected transfers;
+     * reads (regmap filling its cache) are answered but not logged.
+     *
+     * Included at the end of imx377.c, so the static helpers are reachable.
+     */
+
+    #include <kunit/test.h>
+    #include <linux/unaligned.h>
+
+    #define IMX377_TEST_LOG         32
+
+    /* One write message as it went on the bus: address bytes, then values */
+    struct imx377_test_xfer {
+        u16 len;
+        u8  buf[2 + IMX377_MAX_BURST];
+    };
+
+    #define IMX377_XFER(...)                                                \
+        { .len = sizeof((const u8[]){ __VA_ARGS__ }), .buf = { __VA_ARGS__ } }
+
+    struct imx377_test {
+        struct i2c_adapter      adap;
+        struct i2c_client       *client;
+        struct imx377           *priv;
+        u8                      regs[IMX377_REG_LAST + 1];
+        struct imx377_test_xfer log[IMX377_TEST_LOG];
+        unsigned int            nr_log;     /* may run past IMX377_TEST_LOG */
+    };
+
+    /* ------------------------------------------------------------------ */
+    /* Fake sensor                                                         */
+    /* ------------------------------------------------------------------ */
+
+    static int imx377_test_master_xfer(struct i2c_adapter *adap,
+                                       struct i2c_msg *msgs, int num)
+    {
+        struct imx377_test *t = i2c_get_adapdata(adap);
+        struct imx377_test_xfer *x;
+        u16 reg, len;
+
+        if (msgs[0].flags & I2C_M_RD || msgs[0].len < 2)
+            return -EIO;
+        reg = get_unaligned_be16(msgs[0].buf);
+
+        /* Register read: the address, then a read from there on */
+        if (num == 2 && msgs[1].flags & I2C_M_RD) {
+            if (reg + msgs[1].len > sizeof(t->regs))
+                return -EIO;
+            memcpy(msgs[1].buf, &t->regs[reg], msgs[1].len);
+            return num;
+        }
+
+        len = msgs[0].len - 2;
+        if (num != 1 || reg + len > sizeof(t->regs) ||
+            msgs[0].len > sizeof(x->buf))
+            return -EIO;
+        memcpy(&t->regs[reg], msgs[0].buf + 2, len);
+
+        if (t->nr_log < IMX377_TEST_LOG) {
+            x = &t->log[t->nr_log];
+            x->len = msgs[0].len;
+            memcpy(x->buf, msgs[0].buf, msgs[0].len);
+        }
+        t->nr_log++;
+        return num;
+    }
+
+    static u32 imx377_test_functionality(struct i2c_adapter *adap)
+    {
+        return I2C_FUNC_I2C;
+    }
+
+    static const struct i2c_algorithm imx377_test_algo = {
+        .master_xfer    = imx377_test_master_xfer,
+        .functionality  = imx377_test_functionality,
+    };
+
+    /* Everything written since the last check must be exactly @want */
+    static void imx377_test_expect(struct kunit *test,
+                                   const struct imx377_test_xfer *want,
+                                   unsigned int n)
+    {
+        struct imx377_test *t = test->priv;
+        unsigned int i;
+
+        KUNIT_ASSERT_EQ(test, t->nr_log, n);
+        for (i = 0; i < n; i++) {
+            KUNIT_EXPECT_EQ_MSG(test, t->log[i].len, want[i].len,
+                                "transfer %u", i);
+            KUNIT_EXPECT_MEMEQ_MSG(test, t->log[i].buf, want[i].buf,
+                                   want[i].len, "transfer %u", i);
+        }
+        t->nr_log = 0;
+    }
+
+    static int imx377_test_s_stream(struct imx377 *priv, int enable)
+    {
+        return imx377_s_stream(&priv->sd, enable);
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Setup / teardown                                                    */
+    /* ------------------------------------------------------------------ */
+
+    static void imx377_test_del_adapter(void *adap)
+    {
+        i2c_del_adapter(adap);
+    }
+
+    static void imx377_test_unregister(void *client)
+    {
+        i2c_unregister_device(client);
+    }
+
+    static void imx377_test_regmap_exit(void *regmap)
+    {
+        regmap_exit(regmap);
+    }
+
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+    static void imx377_test_free_stats(void *stats)
+    {
+        free_percpu(stats);
+    }
+    #endif
+
+    static void imx377_test_free_ctrls(void *priv)
+    {
+        v4l2_ctrl_handler_free(&((struct imx377 *)priv)->ctrls);
+    }
+
+    static void imx377_test_pm_disable(void *dev)
+    {
+        pm_runtime_disable(dev);
+        pm_runtime_set_suspended(dev);
+        pm_runtime_put_noidle(dev);
+    }
+
+    /* A failed test may leave the stream, and with it the frame timer, running */
+    static void imx377_test_stop(void *priv)
+    {
+        imx377_test_s_stream(priv, 0);
+    }
+
+    /*
+     * The driver state probe would leave behind, minus the supplies, clock
+     * and GPIOs: built‑in modes, controls at their defaults, runtime PM
+     * active. There is no power‑on, so the first stream‑on sends the tables.
+     */
+    static int imx377_test_init(struct kunit *test)
+    {
+        struct i2c_board_info info = { I2C_BOARD_INFO("imx377-kunit", 0x1a) };
+        struct imx377_test *t;
+        struct imx377 *priv;
+        struct device *dev;
+
+        t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, t);
+        test->priv = t;
+
+        t->adap.owner = THIS_MODULE;
+        t->adap.algo = &imx377_test_algo;
+        strscpy(t->adap.name, "imx377-kunit", sizeof(t->adap.name));
+        i2c_set_adapdata(&t->adap, t);
+        KUNIT_ASSERT_EQ(test, i2c_add_adapter(&t->adap), 0);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_del_adapter,
+                                                        &t->adap), 0);
+
+        t->client = i2c_new_client_device(&t->adap, &info);
+        KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->client);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_unregister,
+                                                        t->client), 0);
+        dev = &t->client->dev;
+
+        priv = kunit_kzalloc(test, sizeof(*priv), GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, priv);
+        t->priv = priv;
+
+        priv->client = t->client;
+        mutex_init(&priv->lock);
+        mutex_init(&priv->queue_lock);
+        INIT_WORK(&priv->frame_work, imx377_frame_work);
+        INIT_DELAYED_WORK(&priv->sync_work, imx377_sync_work);
+        hrtimer_setup(&priv->frame_timer, imx377_frame_timer_fn, CLOCK_MONOTONIC,
+                      HRTIMER_MODE_ABS);
+        priv->regmap = regmap_init_i2c(t->client, &imx377_regmap_config);
+        KUNIT_ASSERT_NOT_ERR_OR_NULL(test, priv->regmap);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_regmap_exit,
+                                                        priv->regmap), 0);
+
+    #ifdef CONFIG_VIDEO_IMX377_STATS
+        priv->stats = alloc_percpu(struct imx377_stats);
+        KUNIT_ASSERT_NOT_NULL(test, priv->stats);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_free_stats,
+                                                        priv->stats), 0);
+    #endif
+
+        priv->modes = imx377_modes;
+        priv->num_modes = ARRAY_SIZE(imx377_modes);
+        priv->formats = imx377_formats;
+        priv->num_formats = ARRAY_SIZE(imx377_formats);
+        priv->cur_mode = imx377_default_mode;
+        priv->cur_fmt = &imx377_formats[0];
+        priv->crop = priv->cur_mode->crop;
+
+        /* As in probe, the control defaults only reach the regcache */
+        regcache_cache_only(priv->regmap, true);
+        KUNIT_ASSERT_EQ(test, imx377_init_controls(priv), 0);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_free_ctrls,
+                                                        priv), 0);
+        regcache_cache_only(priv->regmap, false);
+
+        pm_runtime_set_active(dev);
+        pm_runtime_get_noresume(dev);
+        pm_runtime_enable(dev);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_pm_disable,
+                                                        dev), 0);
+        KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, imx377_test_stop,
+                                                        priv), 0);
+
+        KUNIT_ASSERT_EQ(test, t->nr_log, 0);
+        return 0;
+    }
+
+    /* ------------------------------------------------------------------ */
+    /* Tests                                                               */
+    /* ------------------------------------------------------------------ */
+
+    /* 4056x3040 RAW12, full window, VMAX 0x0CB2, gain 0, exposure 0x03E8 */
+    static const struct imx377_test_xfer imx377_test_cold_start[] = {
+        IMX377_XFER(0x30, 0x00, 0x00),                          /* STANDBY */
+        IMX377_XFER(0x30, 0x04, 0x00, 0x01, 0x00, 0x00),        /* MDSEL1..4 */
+        IMX377_XFER(0x30, 0xF5, 0x01, 0x72),                    /* HMAX */
+        IMX377_XFER(0x30, 0x08, 0x01),                          /* ADBIT */
+        IMX377_XFER(0x30, 0x44, 0x01),                          /* ODBIT */
+        IMX377_XFER(0x31, 0x20, 0x00, 0x00, 0x0F, 0xD8,
+                                0x00, 0x00, 0x0B, 0xE0),        /* window */
+        IMX377_XFER(0x30, 0xF7, 0x0C, 0xB2),                    /* VMAX */
+        IMX377_XFER(0x30, 0x09, 0x00, 0x00, 0x03, 0xE8),        /* gain, exposure */
+        IMX377_XFER(0x01, 0x00, 0x01),                          /* MODE_SELECT */
+    };
+
+    static void imx377_test_stream_on(struct kunit *test)
+    {
+        struct imx377_test *t = test->priv;
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(t->priv, 1), 0);
+        imx377_test_expect(test, imx377_test_cold_start,
+                           ARRAY_SIZE(imx377_test_cold_start));
+    }
+
+    static void imx377_test_pause_resume(struct kunit *test)
+    {
+        static const struct imx377_test_xfer pause[] = {
+            IMX377_XFER(0x30, 0x00, 0x01),
+        };
+        static const struct imx377_test_xfer resume[] = {
+            IMX377_XFER(0x30, 0x00, 0x00),
+        };
+        struct imx377_test *t = test->priv;
+
+        if (!idle_standby)
+            kunit_skip(test, "idle_standby=0");
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(t->priv, 1), 0);
+        t->nr_log = 0;
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(t->priv, 0), 0);
+        imx377_test_expect(test, pause, ARRAY_SIZE(pause));
+
+        /* Nothing changed while paused: leaving standby is the restart */
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(t->priv, 1), 0);
+        imx377_test_expect(test, resume, ARRAY_SIZE(resume));
+    }
+
+    /*
+     * 4056x3040 to 1920x1080 while streaming: the delta only, RAW12 stays,
+     * and VMAX, gain and exposure exactly once, inside the standby window
+     */
+    static void imx377_test_mode_switch(struct kunit *test)
+    {
+        static const struct imx377_test_xfer want[] = {
+            IMX377_XFER(0x30, 0x00, 0x01),                      /* STANDBY */
+            IMX377_XFER(0x30, 0x04, 0x11),                      /* MDSEL1 */
+            IMX377_XFER(0x30, 0x07, 0x10),                      /* MDSEL4 */
+            IMX377_XFER(0x30, 0xF5, 0x00, 0xAF),                /* HMAX */
+            IMX377_XFER(0x31, 0x20, 0x00, 0x6C, 0x0F, 0x00,
+                                    0x01, 0xB8, 0x08, 0x70),    /* window */
+            IMX377_XFER(0x30, 0xF7, 0x05, 0xF4),                /* VMAX */
+            IMX377_XFER(0x30, 0x09, 0x00, 0x00, 0x03, 0xE8),    /* gain, exposure */
+            IMX377_XFER(0x30, 0x00, 0x00),                      /* STANDBY */
+        };
+        struct imx377_test *t = test->priv;
+        struct imx377 *priv = t->priv;
+        int ret;
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(priv, 1), 0);
+        t->nr_log = 0;
+
+        mutex_lock(&priv->lock);
+        ret = imx377_switch_mode(priv, &imx377_modes[2], priv->cur_fmt);
+        mutex_unlock(&priv->lock);
+        KUNIT_ASSERT_EQ(test, ret, 0);
+        KUNIT_EXPECT_TRUE(test, priv->streaming);
+        imx377_test_expect(test, want, ARRAY_SIZE(want));
+    }
+
+    /*
+     * A VBLANK change while streaming is only queued; each register then goes
+     * out its own delay ahead of the target frame, inside a REGHOLD window.
+     * The frame clock is stopped and driven by hand.
+     */
+    static void imx377_test_ctrl_update(struct kunit *test)
+    {
+        static const struct imx377_test_xfer exposure[] = {
+            IMX377_XFER(0x30, 0x01, 0x01),                      /* HOLD */
+            IMX377_XFER(0x30, 0xF7, 0x0D, 0x0C),                /* VMAX */
+            IMX377_XFER(0x30, 0x0B, 0x03, 0xE8),                /* exposure */
+            IMX377_XFER(0x30, 0x01, 0x00),                      /* HOLD */
+        };
+        static const struct imx377_test_xfer gain[] = {
+            IMX377_XFER(0x30, 0x01, 0x01),
+            IMX377_XFER(0x30, 0x09, 0x00, 0x00),                /* gain */
+            IMX377_XFER(0x30, 0x01, 0x00),
+        };
+        struct imx377_test *t = test->priv;
+        struct imx377 *priv = t->priv;
+        u64 target;
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(priv, 1), 0);
+
+        mutex_lock(&priv->queue_lock);
+        priv->ticking = false;
+        mutex_unlock(&priv->queue_lock);
+        hrtimer_cancel(&priv->frame_timer);
+        cancel_work_sync(&priv->frame_work);
+        t->nr_log = 0;
+
+        /* 3040 lines + 300 = VMAX 0x0D0C */
+        KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(priv->vblank_ctrl, 300), 0);
+        KUNIT_EXPECT_EQ(test, t->nr_log, 0);
+        KUNIT_ASSERT_EQ(test, priv->queue_len, 1);
+        target = priv->queue[priv->queue_head].target;
+
+        mutex_lock(&priv->queue_lock);
+        imx377_frame_tick(priv, target - IMX377_EXPOSURE_DELAY);
+        mutex_unlock(&priv->queue_lock);
+        imx377_test_expect(test, exposure, ARRAY_SIZE(exposure));
+        KUNIT_EXPECT_EQ(test, priv->vts, 0x0D0C);
+
+        mutex_lock(&priv->queue_lock);
+        imx377_frame_tick(priv, target - IMX377_GAIN_DELAY);
+        mutex_unlock(&priv->queue_lock);
+        imx377_test_expect(test, gain, ARRAY_SIZE(gain));
+        KUNIT_EXPECT_EQ(test, priv->queue_len, 0);
+    }
+
+    /*
+     * A change still queued at pause time never reached the sensor, so the
+     * resume has to be a full one that flushes the controls.
+     */
+    static void imx377_test_pause_queued(struct kunit *test)
+    {
+        static const struct imx377_test_xfer pause[] = {
+            IMX377_XFER(0x30, 0x00, 0x01),
+        };
+        static const struct imx377_test_xfer resume[] = {
+            IMX377_XFER(0x30, 0x00, 0x00),                      /* STANDBY */
+            IMX377_XFER(0x31, 0x20, 0x00, 0x00, 0x0F, 0xD8,
+                                    0x00, 0x00, 0x0B, 0xE0),    /* window */
+            IMX377_XFER(0x30, 0xF7, 0x0D, 0x0C),                /* VMAX */
+            IMX377_XFER(0x30, 0x09, 0x00, 0x00, 0x03, 0xE8),    /* gain, exposure */
+            IMX377_XFER(0x01, 0x00, 0x01),                      /* MODE_SELECT */
+        };
+        struct imx377_test *t = test->priv;
+        struct imx377 *priv = t->priv;
+
+        if (!idle_standby)
+            kunit_skip(test, "idle_standby=0");
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(priv, 1), 0);
+
+        mutex_lock(&priv->queue_lock);
+        priv->ticking = false;
+        mutex_unlock(&priv->queue_lock);
+        hrtimer_cancel(&priv->frame_timer);
+        cancel_work_sync(&priv->frame_work);
+        t->nr_log = 0;
+
+        KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(priv->vblank_ctrl, 300), 0);
+        KUNIT_ASSERT_EQ(test, priv->queue_len, 1);
+        KUNIT_EXPECT_EQ(test, t->nr_log, 0);
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(priv, 0), 0);
+        imx377_test_expect(test, pause, ARRAY_SIZE(pause));
+        KUNIT_EXPECT_TRUE(test, priv->resume_dirty);
+
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(priv, 1), 0);
+        imx377_test_expect(test, resume, ARRAY_SIZE(resume));
+        KUNIT_EXPECT_EQ(test, priv->vts, 0x0D0C);
+    }
+
+    /*
+     * Software trigger: stream‑on arms the sensor in standby, a press takes
+     * it out for one frame, and the end of that frame puts it back. There is
+     * no XVS, so the frame end is driven by hand.
+     */
+    static void imx377_test_trigger(struct kunit *test)
+    {
+        static const struct imx377_test_xfer arm[] = {
+            IMX377_XFER(0x30, 0x00, 0x01),                      /* STANDBY */
+            IMX377_XFER(0x30, 0x04, 0x00, 0x01, 0x00, 0x00),    /* MDSEL1..4 */
+            IMX377_XFER(0x30, 0xF5, 0x01, 0x72),                /* HMAX */
+            IMX377_XFER(0x30, 0x08, 0x01),                      /* ADBIT */
+            IMX377_XFER(0x30, 0x44, 0x01),                      /* ODBIT */
+            IMX377_XFER(0x31, 0x20, 0x00, 0x00, 0x0F, 0xD8,
+                                    0x00, 0x00, 0x0B, 0xE0),    /* window */
+            IMX377_XFER(0x30, 0xF7, 0x0C, 0xB2),                /* VMAX */
+            IMX377_XFER(0x30, 0x09, 0x00, 0x00, 0x03, 0xE8),    /* gain, exposure */
+            IMX377_XFER(0x01, 0x00, 0x01),                      /* MODE_SELECT */
+        };
+        static const struct imx377_test_xfer fire[] = {
+            IMX377_XFER(0x30, 0x00, 0x00),
+        };
+        static const struct imx377_test_xfer done[] = {
+            IMX377_XFER(0x30, 0x00, 0x01),
+        };
+        struct imx377_test *t = test->priv;
+        struct imx377 *priv = t->priv;
+        struct v4l2_ctrl *trigger;
+
+        trigger = v4l2_ctrl_find(&priv->ctrls, V4L2_CID_IMX377_SOFTWARE_TRIGGER);
+        KUNIT_ASSERT_NOT_NULL(test, trigger);
+
+        /* Not armed yet */
+        KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(trigger, 0), -EBUSY);
+
+        KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(priv->trig_src_ctrl,
+                                               V4L2_IMX377_TRIGGER_SOFTWARE), 0);
+        KUNIT_ASSERT_EQ(test, imx377_test_s_stream(priv, 1), 0);
+        imx377_test_expect(test, arm, ARRAY_SIZE(arm));
+        KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(priv->trig_src_ctrl,
+                                               V4L2_IMX377_TRIGGER_OFF), -EBUSY);
+
+        KUNIT_ASSERT_EQ(test, v4l2_ctrl_s_ctrl(trigger, 0), 0);
+        hrtimer_cancel(&priv->frame_timer);
+        cancel_work_sync(&priv->frame_work);
+        imx377_test_expect(test, fire, ARRAY_SIZE(fire));
+
+        /* One frame per trigger: a second one during it is dropped */
+        KUNIT_EXPECT_EQ(test, v4l2_ctrl_s_ctrl(trigger, 0), -EBUSY);
+        KUNIT_EXPECT_EQ(test, priv->trig_dropped, 1);
+        KUNIT_EXPECT_EQ(test, t->nr_log, 0);
+
+        mutex_lock(&priv->queue_lock);
+        imx377_trigger_done(priv);
+        mutex_unlock(&priv->queue_lock);
+        imx377_test_expect(test, done, ARRAY_SIZE(done));
+        KUNIT_EXPECT_EQ(test, priv->trig_count, 1);
+    }
+
+    static struct kunit_case imx377_test_cases[] = {
+        KUNIT_CASE(imx377_test_stream_on),
+        KUNIT_CASE(imx377_test_pause_resume),
+        KUNIT_CASE(imx377_test_mode_switch),
+        KUNIT_CASE(imx377_test_ctrl_update),
+        KUNIT_CASE(imx377_test_pause_queued),
+        KUNIT_CASE(imx377_test_trigger),
+        { }
+    };
+
+    static struct kunit_suite imx377_test_suite = {
+        .name       = "imx377",
+        .init       = imx377_test_init,
+        .test_cases = imx377_test_cases,
+    };
+    kunit_test_suite(imx377_test_suite);
@@ -0,0 +1,145 @@
+    /* SPDX-License-Identifier: GPL-2.0 */
+    /*
+     * Sony IMX377 tracepoints: register bursts, power sequencing and stream
+     * transitions. Enable with e.g.
+     *
+     *   echo 1 > /sys/kernel/tracing/events/imx377/enable
+     */
+
+    #undef TRACE_SYSTEM
+    #define TRACE_SYSTEM imx377
+
+    #if !defined(_IMX377_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+    #define _IMX377_TRACE_H
+
+    #include <linux/i2c.h>
+    #include <linux/tracepoint.h>
+
+    #ifndef _IMX377_POWER_PHASE
+    #define _IMX377_POWER_PHASE
+    enum imx377_power_phase {
+        IMX377_PHASE_REGULATORS,
+        IMX377_PHASE_CLOCK,
+        IMX377_PHASE_GPIO,
+        IMX377_PHASE_SETTLE,
+        IMX377_PHASE_REGCACHE,
+    };
+    #endif
+
+    TRACE_DEFINE_ENUM(IMX377_PHASE_REGULATORS);
+    TRACE_DEFINE_ENUM(IMX377_PHASE_CLOCK);
+    TRACE_DEFINE_ENUM(IMX377_PHASE_GPIO);
+    TRACE_DEFINE_ENUM(IMX377_PHASE_SETTLE);
+    TRACE_DEFINE_ENUM(IMX377_PHASE_REGCACHE);
+
+    /* Devices print as their I2C name, "<adapter>-<addr>" */
+    TRACE_EVENT(imx377_burst,
+        TP_PROTO(const struct i2c_client *client, u16 reg, u32 len, u64 ns, int ret),
+        TP_ARGS(client, reg, len, ns, ret),
+        TP_STRUCT__entry(
+            __field(int, adapter)
+            __field(u16, addr)
+            __field(u16, reg)
+            __field(u32, len)
+            __field(u64, ns)
+            __field(int, ret)
+        ),
+        TP_fast_assign(
+            __entry->adapter = i2c_adapter_id(client->adapter);
+            __entry->addr = client->addr;
+            __entry->reg = reg;
+            __entry->len = len;
+            __entry->ns = ns;
+            __entry->ret = ret;
+        ),
+        TP_printk("%d-%04x reg 0x%04x len %u %llu ns ret %d",
+                  __entry->adapter, __entry->addr, __entry->reg, __entry->len,
+                  __entry->ns, __entry->ret)
+    );
+
+    TRACE_EVENT(imx377_power,
+        TP_PROTO(const struct i2c_client *client, bool on,
+                 enum imx377_power_phase phase, u64 ns),
+        TP_ARGS(client, on, phase, ns),
+        TP_STRUCT__entry(
+            __field(int, adapter)
+            __field(u16, addr)
+            __field(bool, on)
+            __field(int, phase)
+            __field(u64, ns)
+        ),
+        TP_fast_assign(
+            __entry->adapter = i2c_adapter_id(client->adapter);
+            __entry->addr = client->addr;
+            __entry->on = on;
+            __entry->phase = phase;
+            __entry->ns = ns;
+        ),
+        TP_printk("%d-%04x power %s %s %llu ns",
+                  __entry->adapter, __entry->addr, __entry->on ? "on" : "off",
+                  __print_symbolic(__entry->phase,
+                                   { IMX377_PHASE_REGULATORS, "regulators" },
+                                   { IMX377_PHASE_CLOCK,      "clock" },
+                                   { IMX377_PHASE_GPIO,       "gpio" },
+                                   { IMX377_PHASE_SETTLE,     "settle" },
+                                   { IMX377_PHASE_REGCACHE,   "regcache" }),
+                  __entry->ns)
+    );
+
+    TRACE_EVENT(imx377_stream_on,
+        TP_PROTO(const struct i2c_client *client, u32 width, u32 height, u32 code,
+                 u32 vts, bool cold, u64 ns, int ret),
+        TP_ARGS(client, width, height, code, vts, cold, ns, ret),
+        TP_STRUCT__entry(
+            __field(int, adapter)
+            __field(u16, addr)
+            __field(u32, width)
+            __field(u32, height)
+            __field(u32, code)
+            __field(u32, vts)
+            __field(bool, cold)
+            __field(u64, ns)
+            __field(int, ret)
+        ),
+        TP_fast_assign(
+            __entry->adapter = i2c_adapter_id(client->adapter);
+            __entry->addr = client->addr;
+            __entry->width = width;
+            __entry->height = height;
+            __entry->code = code;
+            __entry->vts = vts;
+            __entry->cold = cold;
+            __entry->ns = ns;
+            __entry->ret = ret;
+        ),
+        TP_printk("%d-%04x %ux%u code 0x%04x vts %u %s start %llu ns ret %d",
+                  __entry->adapter, __entry->addr, __entry->width,
+                  __entry->height, __entry->code, __entry->vts,
+                  __entry->cold ? "cold" : "warm", __entry->ns, __entry->ret)
+    );
+
+    TRACE_EVENT(imx377_stream_off,
+        TP_PROTO(const struct i2c_client *client, int ret),
+        TP_ARGS(client, ret),
+        TP_STRUCT__entry(
+            __field(int, adapter)
+            __field(u16, addr)
+            __field(int, ret)
+        ),
+        TP_fast_assign(
+            __entry->adapter = i2c_adapter_id(client->adapter);
+            __entry->addr = client->addr;
+            __entry->ret = ret;
+        ),
+        TP_printk("%d-%04x ret %d", __entry->adapter, __entry->addr,
+                  __entry->ret)
+    );
+
+    #endif /* _IMX377_TRACE_H */
+
+    /* This part must be outside the header guard */
+    #undef TRACE_INCLUDE_PATH
+    #define TRACE_INCLUDE_PATH .
+    #undef TRACE_INCLUDE_FILE
+    #define TRACE_INCLUDE_FILE imx377_trace
+    #include <trace/define_trace.h>
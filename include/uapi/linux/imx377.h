@@ -0,0 +1,38 @@
+    /* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+    /*
+     * Sony IMX377 driver‑specific V4L2 controls
+     */
+
+    #ifndef __UAPI_IMX377_H_
+    #define __UAPI_IMX377_H_
+
+    #include <linux/v4l2-controls.h>
+
+    /*
+     * 16 controls from V4L2_CID_USER_IMX377_BASE. Upstream v4l2-controls.h
+     * does not reserve this range: integrators must add the reservation to
+     * their tree (see the README). Defined here for trees that do not.
+     */
+    #ifndef V4L2_CID_USER_IMX377_BASE
+    #define V4L2_CID_USER_IMX377_BASE       (V4L2_CID_USER_BASE + 0x1300)
+    #endif
+
+    /* Frames from a register write until the new value shows (read‑only) */
+    #define V4L2_CID_IMX377_EXPOSURE_DELAY  (V4L2_CID_USER_IMX377_BASE + 0)
+    #define V4L2_CID_IMX377_GAIN_DELAY      (V4L2_CID_USER_IMX377_BASE + 1)
+
+    /*
+     * Frame‑on‑demand capture. With a source other than OFF, stream‑on only
+     * arms the sensor, and each pulse on the board's trigger input (GPIO) or
+     * each press of the SOFTWARE_TRIGGER button gives exactly one frame.
+     * The source can only change while stopped.
+     */
+    #define V4L2_CID_IMX377_TRIGGER_SOURCE  (V4L2_CID_USER_IMX377_BASE + 2)
+    enum v4l2_imx377_trigger_source {
+        V4L2_IMX377_TRIGGER_OFF         = 0,    /* free‑running */
+        V4L2_IMX377_TRIGGER_GPIO        = 1,
+        V4L2_IMX377_TRIGGER_SOFTWARE    = 2,
+    };
+    #define V4L2_CID_IMX377_SOFTWARE_TRIGGER (V4L2_CID_USER_IMX377_BASE + 3)
+
+    #endif /* __UAPI_IMX377_H_ */
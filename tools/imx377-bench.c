@@ -0,0 +1,667 @@
+    /* SPDX-License-Identifier: GPL-2.0 */
+    /*
+     * imx377-bench: time‑to‑first‑frame and stream‑cycle benchmark for the
+     * IMX377 driver, against a real sensor and receiver or against imx377-emu.
+     *
+     * Each cycle optionally re‑probes the driver (unbind/bind) and sets the
+     * format on the subdev devnode. With a video node (-v) it then streams
+     * through the receiver as an application would: REQBUFS, QBUF,
+     * STREAMON, the first DQBUF, STREAMOFF. With no receiver bound (-S) it
+     * starts and stops the sensor through the driver's debugfs "stream"
+     * file instead (CONFIG_VIDEO_IMX377_BENCH); there is no frame then, so
+     * first_frame_wall is missing and stream_on ends at the driver's
+     * estimate of the first frame start. It collects the driver's
+     * per‑step timings ("steps": regulators, xclk, reset release, settle,
+     * regcache sync, tables, window, control flush, MODE_SELECT, ...). The driver only times
+     * the power phases while the imx377_power trace event is on, so the
+     * bench turns it on for the run. At the end it prints p50/p99 per step
+     * and can store or check a baseline.
+     *
+     *   imx377-bench -d 1-001a -v /dev/video0 -n 200 -c -w base.txt
+     *   imx377-bench -d 1-001a -v /dev/video0 -n 200 -c -b base.txt
+     *   imx377-bench -d 1-001a -s /dev/v4l-subdev0 -f 2028x1520 -n 200 -p
+     *   imx377-bench -d 1-001a -S -n 200 -c -b emu-base.txt
+     *
+     * The receiver's format has to match the sensor's already (media-ctl,
+     * v4l2-ctl); the bench does not configure the pipeline.
+     *
+     * Needs root (debugfs, tracefs, sysfs bind/unbind).
+     */
+
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <sys/ioctl.h>
+    #include <time.h>
+    #include <unistd.h>
+    #include <linux/videodev2.h>
+    #include <linux/v4l2-subdev.h>
+
+    #define MAX_STEPS       32
+    #define MAX_NAME        32
+    #define NOISE_FLOOR_NS  50000   /* changes below this never count as regressions */
+    #define POWER_EVENT     "/sys/kernel/tracing/events/imx377/imx377_power/enable"
+    #define NUM_BUFS        4
+    #define FRAME_TIMEOUT_MS 2000
+    #define SUSPEND_MARGIN_MS 500   /* past autosuspend_delay_ms */
+
+    struct step {
+        char name[MAX_NAME];
+        uint64_t *ns;
+        unsigned int count;
+    };
+
+    static struct step steps[MAX_STEPS];
+    static unsigned int num_steps;
+    static unsigned int max_cycles;
+
+    static const char *dev_name;
+    static char debugfs_dir[256];
+    static char power_event_was[4];
+    static char autosuspend_was[32];
+
+    static int video_fd = -1;
+    static enum v4l2_buf_type buf_type;
+
+    static uint64_t now_ns(void)
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    static struct step *step_get(const char *name)
+    {
+        unsigned int i;
+
+        for (i = 0; i < num_steps; i++)
+            if (!strcmp(steps[i].name, name))
+                return &steps[i];
+        if (num_steps == MAX_STEPS)
+            return NULL;
+
+        snprintf(steps[num_steps].name, MAX_NAME, "%s", name);
+        steps[num_steps].ns = calloc(max_cycles, sizeof(uint64_t));
+        if (!steps[num_steps].ns)
+            return NULL;
+        return &steps[num_steps++];
+    }
+
+    static void step_add(const char *name, uint64_t ns)
+    {
+        struct step *s = step_get(name);
+
+        if (s && s->count < max_cycles)
+            s->ns[s->count++] = ns;
+    }
+
+    static int write_str(const char *path, const char *val)
+    {
+        int fd, ret = 0;
+
+        fd = open(path, O_WRONLY);
+        if (fd < 0)
+            return -errno;
+        if (write(fd, val, strlen(val)) < 0)
+            ret = -errno;
+        close(fd);
+        return ret;
+    }
+
+    static int read_str(const char *path, char *buf, size_t len)
+    {
+        ssize_t n;
+        int fd;
+
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return -errno;
+        n = read(fd, buf, len - 1);
+        close(fd);
+        if (n < 0)
+            return -errno;
+        buf[n] = '\0';
+        return 0;
+    }
+
+    static void restore_power_event(void)
+    {
+        write_str(POWER_EVENT, power_event_was);
+    }
+
+    /* Power‑phase steps are only recorded while the trace event is on */
+    static int enable_power_event(void)
+    {
+        int ret;
+
+        ret = read_str(POWER_EVENT, power_event_was, sizeof(power_event_was));
+        if (ret)
+            return ret;
+        ret = write_str(POWER_EVENT, "1");
+        if (ret)
+            return ret;
+        atexit(restore_power_event);
+        return 0;
+    }
+
+    static int sysfs_dev(const char *attr, char *path, size_t len)
+    {
+        return snprintf(path, len, "/sys/bus/i2c/devices/%s/%s", dev_name, attr);
+    }
+
+    /* Take the driver's step timings; zero steps did not run this time */
+    static int collect_steps(const char *const *only, unsigned int n_only)
+    {
+        char path[300], name[MAX_NAME];
+        unsigned long long ns;
+        unsigned int i;
+        FILE *f;
+
+        snprintf(path, sizeof(path), "%s/steps", debugfs_dir);
+        f = fopen(path, "r");
+        if (!f)
+            return -errno;
+
+        while (fscanf(f, "%31s %llu", name, &ns) == 2) {
+            for (i = 0; i < n_only; i++)
+                if (!strcmp(name, only[i]))
+                    break;
+            if (n_only && i == n_only)
+                continue;
+            if (ns)
+                step_add(name, ns);
+        }
+        fclose(f);
+        return 0;
+    }
+
+    static int wait_debugfs(void)
+    {
+        int i;
+
+        for (i = 0; i < 200; i++) {
+            if (!access(debugfs_dir, F_OK))
+                return 0;
+            usleep(5000);
+        }
+        return -ETIMEDOUT;
+    }
+
+    /* Runtime PM powers the sensor down autosuspend_delay_ms after its last use */
+    static int wait_suspended(void)
+    {
+        char path[300], buf[32];
+        uint64_t deadline;
+        long delay;
+        int ret;
+
+        sysfs_dev("power/autosuspend_delay_ms", path, sizeof(path));
+        ret = read_str(path, buf, sizeof(buf));
+        if (ret)
+            return ret;
+        delay = strtol(buf, NULL, 10);
+        if (delay < 0)
+            return -EINVAL;     /* never powers down */
+        deadline = now_ns() + (uint64_t)(delay + SUSPEND_MARGIN_MS) * 1000000ULL;
+
+        sysfs_dev("power/runtime_status", path, sizeof(path));
+        do {
+            if (!read_str(path, buf, sizeof(buf)) && !strncmp(buf, "suspended", 9))
+                return 0;
+            usleep(5000);
+        } while (now_ns() < deadline);
+        return -ETIMEDOUT;
+    }
+
+    static void restore_autosuspend(void)
+    {
+        char path[300];
+
+        sysfs_dev("power/autosuspend_delay_ms", path, sizeof(path));
+        write_str(path, autosuspend_was);
+    }
+
+    /*
+     * Cold cycles: power down right after stream‑off. Probe sets the delay
+     * again, so this is repeated after every reprobe; the first call saves
+     * the original, which is put back on exit.
+     */
+    static int autosuspend_off(void)
+    {
+        char path[300];
+        int ret;
+
+        sysfs_dev("power/autosuspend_delay_ms", path, sizeof(path));
+        if (!autosuspend_was[0]) {
+            ret = read_str(path, autosuspend_was, sizeof(autosuspend_was));
+            if (ret)
+                return ret;
+            atexit(restore_autosuspend);
+        }
+        return write_str(path, "0");
+    }
+
+    static int reprobe(void)
+    {
+        static const char *const probe_steps[] = { "probe" };
+        uint64_t t;
+        int ret;
+
+        ret = write_str("/sys/bus/i2c/drivers/imx377/unbind", dev_name);
+        if (ret)
+            return ret;
+        t = now_ns();
+        ret = write_str("/sys/bus/i2c/drivers/imx377/bind", dev_name);
+        if (ret)
+            return ret;
+        step_add("bind_wall", now_ns() - t);
+
+        ret = wait_debugfs();
+        return ret ? ret : collect_steps(probe_steps, 1);
+    }
+
+    static int set_fmt(const char *subdev, unsigned int width, unsigned int height)
+    {
+        struct v4l2_subdev_format fmt = {
+            .which = V4L2_SUBDEV_FORMAT_ACTIVE,
+            .pad = 0,
+        };
+        uint64_t t;
+        int fd, ret = 0;
+
+        fd = open(subdev, O_RDWR);
+        if (fd < 0)
+            return -errno;
+
+        if (ioctl(fd, VIDIOC_SUBDEV_G_FMT, &fmt) < 0) {
+            ret = -errno;
+            goto out;
+        }
+        fmt.format.width = width;
+        fmt.format.height = height;
+
+        t = now_ns();
+        if (ioctl(fd, VIDIOC_SUBDEV_S_FMT, &fmt) < 0)
+            ret = -errno;
+        else
+            step_add("set_fmt", now_ns() - t);
+    out:
+        close(fd);
+        return ret;
+    }
+
+    static int video_open(const char *node)
+    {
+        struct v4l2_capability cap;
+        uint32_t caps;
+
+        /* Non‑blocking, so a receiver that never delivers cannot hang DQBUF */
+        video_fd = open(node, O_RDWR | O_NONBLOCK);
+        if (video_fd < 0)
+            return -errno;
+        if (ioctl(video_fd, VIDIOC_QUERYCAP, &cap) < 0)
+            return -errno;
+
+        caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps
+                                                       : cap.capabilities;
+        if (!(caps & V4L2_CAP_STREAMING))
+            return -ENOTTY;
+        if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE)
+            buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        else if (caps & V4L2_CAP_VIDEO_CAPTURE)
+            buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        else
+            return -ENOTTY;
+        return 0;
+    }
+
+    /* A buffer descriptor for @index; multi‑planar ones carry a plane array */
+    static void video_buf(struct v4l2_buffer *buf, struct v4l2_plane *planes,
+                          unsigned int index)
+    {
+        memset(buf, 0, sizeof(*buf));
+        buf->type = buf_type;
+        buf->memory = V4L2_MEMORY_MMAP;
+        buf->index = index;
+        if (buf_type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+            memset(planes, 0, VIDEO_MAX_PLANES * sizeof(*planes));
+            buf->m.planes = planes;
+            buf->length = VIDEO_MAX_PLANES;
+        }
+    }
+
+    /* @count 0 frees the buffers again */
+    static int video_reqbufs(unsigned int count)
+    {
+        struct v4l2_requestbuffers req = {
+            .count = count,
+            .type = buf_type,
+            .memory = V4L2_MEMORY_MMAP,
+        };
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];
+        struct v4l2_buffer buf;
+        unsigned int i;
+
+        if (ioctl(video_fd, VIDIOC_REQBUFS, &req) < 0)
+            return -errno;
+        if (count && !req.count)
+            return -ENOMEM;
+
+        for (i = 0; i < req.count; i++) {
+            video_buf(&buf, planes, i);
+            if (ioctl(video_fd, VIDIOC_QBUF, &buf) < 0)
+                return -errno;
+        }
+        return 0;
+    }
+
+    static int video_first_frame(void)
+    {
+        struct pollfd pfd = { .fd = video_fd, .events = POLLIN };
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];
+        struct v4l2_buffer buf;
+        int ret;
+
+        ret = poll(&pfd, 1, FRAME_TIMEOUT_MS);
+        if (ret < 0)
+            return -errno;
+        if (!ret)
+            return -ETIMEDOUT;
+
+        video_buf(&buf, planes, 0);
+        if (ioctl(video_fd, VIDIOC_DQBUF, &buf) < 0)
+            return -errno;
+        return 0;
+    }
+
+    static int stream_cycle(void)
+    {
+        static const char *const on_steps[] = {
+            "regulators", "xclk", "reset_release", "settle", "regcache_sync",
+            "tables", "window", "ctrl_flush", "mode_select", "stream_on",
+        };
+        static const char *const off_steps[] = { "stream_off" };
+        int type = buf_type;
+        uint64_t t;
+        int ret;
+
+        ret = video_reqbufs(NUM_BUFS);
+        if (ret)
+            goto out_free;
+
+        t = now_ns();
+        if (ioctl(video_fd, VIDIOC_STREAMON, &type) < 0) {
+            ret = -errno;
+            goto out_free;
+        }
+        step_add("stream_on_wall", now_ns() - t);
+
+        ret = video_first_frame();
+        if (ret)
+            goto out_off;
+        step_add("first_frame_wall", now_ns() - t);
+
+        ret = collect_steps(on_steps, sizeof(on_steps) / sizeof(on_steps[0]));
+        if (ret)
+            goto out_off;
+
+        if (ioctl(video_fd, VIDIOC_STREAMOFF, &type) < 0) {
+            ret = -errno;
+            goto out_free;
+        }
+        video_reqbufs(0);
+        return collect_steps(off_steps, 1);
+
+    out_off:
+        ioctl(video_fd, VIDIOC_STREAMOFF, &type);
+    out_free:
+        video_reqbufs(0);
+        return ret;
+    }
+
+    static int access_stream(void)
+    {
+        char path[300];
+
+        snprintf(path, sizeof(path), "%s/stream", debugfs_dir);
+        return access(path, W_OK);
+    }
+
+    /* No receiver: the driver's bench hook stands in for the bridge */
+    static int debugfs_stream_cycle(void)
+    {
+        static const char *const on_steps[] = {
+            "regulators", "xclk", "reset_release", "settle", "regcache_sync",
+            "tables", "window", "ctrl_flush", "mode_select", "stream_on",
+        };
+        static const char *const off_steps[] = { "stream_off" };
+        char path[300];
+        uint64_t t;
+        int ret;
+
+        snprintf(path, sizeof(path), "%s/stream", debugfs_dir);
+
+        t = now_ns();
+        ret = write_str(path, "1");
+        if (ret)
+            return ret;
+        step_add("stream_on_wall", now_ns() - t);
+
+        ret = collect_steps(on_steps, sizeof(on_steps) / sizeof(on_steps[0]));
+        if (ret) {
+            write_str(path, "0");
+            return ret;
+        }
+
+        ret = write_str(path, "0");
+        return ret ? ret : collect_steps(off_steps, 1);
+    }
+
+    static int cmp_u64(const void *a, const void *b)
+    {
+        uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+        return x < y ? -1 : x > y;
+    }
+
+    /* Nearest‑rank percentile of a sorted set */
+    static uint64_t pct(const struct step *s, unsigned int p)
+    {
+        unsigned int rank = (s->count * p + 99) / 100;
+
+        return s->ns[rank ? rank - 1 : 0];
+    }
+
+    static int check_baseline(const char *file, double tol)
+    {
+        unsigned long long b50, b99;
+        char name[MAX_NAME];
+        int regressions = 0;
+        unsigned int i;
+        FILE *f;
+
+        f = fopen(file, "r");
+        if (!f) {
+            perror(file);
+            return -1;
+        }
+
+        while (fscanf(f, "%31s %llu %llu", name, &b50, &b99) == 3) {
+            for (i = 0; i < num_steps; i++) {
+                const struct step *s = &steps[i];
+                uint64_t c50, c99;
+
+                if (strcmp(s->name, name) || !s->count)
+                    continue;
+                c50 = pct(s, 50);
+                c99 = pct(s, 99);
+                if ((c50 > b50 * (1 + tol) && c50 - b50 > NOISE_FLOOR_NS) ||
+                    (c99 > b99 * (1 + tol) && c99 - b99 > NOISE_FLOOR_NS)) {
+                    printf("REGRESSION %-16s p50 %llu -> %llu us, p99 %llu -> %llu us\n",
+                           name, b50 / 1000, (unsigned long long)c50 / 1000,
+                           b99 / 1000, (unsigned long long)c99 / 1000);
+                    regressions++;
+                }
+            }
+        }
+        fclose(f);
+        return regressions;
+    }
+
+    static int write_baseline(const char *file)
+    {
+        unsigned int i;
+        FILE *f;
+
+        f = fopen(file, "w");
+        if (!f) {
+            perror(file);
+            return -1;
+        }
+        for (i = 0; i < num_steps; i++)
+            if (steps[i].count)
+                fprintf(f, "%s %llu %llu\n", steps[i].name,
+                        (unsigned long long)pct(&steps[i], 50),
+                        (unsigned long long)pct(&steps[i], 99));
+        fclose(f);
+        return 0;
+    }
+
+    static void usage(const char *prog)
+    {
+        fprintf(stderr,
+                "usage: %s -d <i2c-dev> [-v <video> | -S] [-s <subdev>] [-f WxH] [-n cycles]\n"
+                "          [-p] [-c] [-b baseline | -w baseline] [-t tolerance%%]\n"
+                "  -d  I2C device name, e.g. 1-001a\n"
+                "  -v  receiver video node to stream through\n"
+                "  -S  no receiver: stream through debugfs (CONFIG_VIDEO_IMX377_BENCH)\n"
+                "  -s  subdev devnode for set_fmt (skipped without one)\n"
+                "  -f  format to set each cycle\n"
+                "  -n  cycles (default 100)\n"
+                "  -p  unbind/bind the driver every cycle\n"
+                "  -c  cold cycles: power down between cycles\n"
+                "  -b  compare against a baseline, exit 2 on regression\n"
+                "  -w  write the results as the new baseline\n"
+                "  -t  allowed slowdown in percent (default 10)\n", prog);
+    }
+
+    int main(int argc, char **argv)
+    {
+        const char *subdev = NULL, *video = NULL, *baseline = NULL, *save = NULL;
+        unsigned int width = 0, height = 0, cycles = 100, i;
+        int reprobe_each = 0, cold = 0, direct = 0, opt, ret;
+        double tol = 0.10;
+
+        while ((opt = getopt(argc, argv, "d:v:Ss:f:n:pcb:w:t:h")) != -1) {
+            switch (opt) {
+            case 'd': dev_name = optarg; break;
+            case 'v': video = optarg; break;
+            case 'S': direct = 1; break;
+            case 's': subdev = optarg; break;
+            case 'f':
+                if (sscanf(optarg, "%ux%u", &width, &height) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n': cycles = strtoul(optarg, NULL, 0); break;
+            case 'p': reprobe_each = 1; break;
+            case 'c': cold = 1; break;
+            case 'b': baseline = optarg; break;
+            case 'w': save = optarg; break;
+            case 't': tol = strtod(optarg, NULL) / 100; break;
+            default:
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        if (!dev_name || !cycles || (video && direct) ||
+            (!video && !direct && !reprobe_each && !(subdev && width))) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        max_cycles = cycles;
+        snprintf(debugfs_dir, sizeof(debugfs_dir), "/sys/kernel/debug/imx377-%s",
+                 dev_name);
+        if (wait_debugfs()) {
+            fprintf(stderr, "%s: not found (driver bound? debugfs mounted?)\n",
+                    debugfs_dir);
+            return 1;
+        }
+
+        if ((ret = enable_power_event()))
+            fprintf(stderr, "%s: %s, power phases will not be timed\n",
+                    POWER_EVENT, strerror(-ret));
+
+        if (direct && access_stream()) {
+            fprintf(stderr, "%s/stream: not found (CONFIG_VIDEO_IMX377_BENCH off?)\n",
+                    debugfs_dir);
+            return 1;
+        }
+        if (video && (ret = video_open(video))) {
+            fprintf(stderr, "%s: %s\n", video, strerror(-ret));
+            return 1;
+        }
+        if (cold && (ret = autosuspend_off())) {
+            fprintf(stderr, "autosuspend_delay_ms: %s\n", strerror(-ret));
+            return 1;
+        }
+
+        for (i = 0; i < cycles; i++) {
+            if (reprobe_each && (ret = reprobe())) {
+                fprintf(stderr, "cycle %u: reprobe failed: %s\n", i, strerror(-ret));
+                return 1;
+            }
+            if (reprobe_each && cold && (ret = autosuspend_off())) {
+                fprintf(stderr, "cycle %u: autosuspend_delay_ms: %s\n", i,
+                        strerror(-ret));
+                return 1;
+            }
+            if (subdev && width && (ret = set_fmt(subdev, width, height))) {
+                fprintf(stderr, "cycle %u: set_fmt failed: %s\n", i, strerror(-ret));
+                return 1;
+            }
+            if (video && (ret = stream_cycle())) {
+                fprintf(stderr, "cycle %u: stream failed: %s\n", i, strerror(-ret));
+                return 1;
+            }
+            if (direct && (ret = debugfs_stream_cycle())) {
+                fprintf(stderr, "cycle %u: stream failed: %s%s\n", i, strerror(-ret),
+                        ret == -EBUSY ? " (bound to a receiver, use -v)" : "");
+                return 1;
+            }
+            if (cold && (ret = wait_suspended())) {
+                fprintf(stderr, "cycle %u: sensor did not power down\n", i);
+                return 1;
+            }
+        }
+
+        printf("%-16s %8s %10s %10s %10s\n", "step", "samples", "p50 us",
+               "p99 us", "max us");
+        for (i = 0; i < num_steps; i++) {
+            struct step *s = &steps[i];
+
+            qsort(s->ns, s->count, sizeof(uint64_t), cmp_u64);
+            printf("%-16s %8u %10llu %10llu %10llu\n", s->name, s->count,
+                   (unsigned long long)pct(s, 50) / 1000,
+                   (unsigned long long)pct(s, 99) / 1000,
+                   (unsigned long long)s->ns[s->count - 1] / 1000);
+        }
+
+        if (save && write_baseline(save))
+            return 1;
+        if (baseline) {
+            ret = check_baseline(baseline, tol);
+            if (ret < 0)
+                return 1;
+            if (ret)
+                return 2;
+        }
+        return 0;
+    }